@@ -0,0 +1,146 @@
+// --- Thrum Pitched Playback Benchmark ---
+// Times the polyphase interpolator the way Thrum drives it with a PITCH cable:
+// 16 voices, each with its own playhead and rate, swept across the full
+// PITCH range so every mip level and cutoff bank is exercised. Only the
+// DSP kernels are linked against the headless engine stand-in, so this builds
+// without linking Rack:
+//   make bench RACK_DIR=<path to Rack SDK>
+// Runs once per resident format (float32, and int16 decoded on the fly) for
+// every kernel set the CPU supports, and prints one line of key=value pairs
+// for each: memory per frame, cost, and the largest deviation from the
+// baseline float32 output. Exits non-zero if any 16-voice cost is over budget.
+#include "dsp/Interpolator.hpp"
+#include "dsp/Kernels.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const int VOICES = 16;
+static const int LEVELS = 3;          // Matches SAMPLE_MIP_LEVELS
+static const size_t GUARD = INTERP_HALF_TAPS;
+static const size_t LENGTH = 1 << 18; // Level-0 frames, larger than L2 like a real drone
+static const float ENGINE_RATE = 48000.f;
+static const int BLOCKS = 400;
+static const int BLOCK_FRAMES = 1024;
+// Budget: 16 voices of interpolated playback in 3% of one core at 48 kHz
+static const double BUDGET_NS_PER_SAMPLE = 0.03 * 1e9 / ENGINE_RATE;
+
+template <typename T>
+struct Level {
+    std::vector<T> buffer;
+    const T* frames;
+    size_t length;
+};
+
+// Float frames read as-is; 16-bit frames go through the widening kernel,
+// as Thrum's playResident() picks between them
+static float read(const DspKernels& kernels, const PolyphaseKernel& kernel, const float* frames, float frac, int bank, float) {
+    return kernels.interpolate(kernel, frames, frac, bank);
+}
+static float read(const DspKernels& kernels, const PolyphaseKernel& kernel, const int16_t* frames, float frac, int bank, float scale) {
+    return kernels.interpolateCompact(kernel, frames, frac, bank, scale);
+}
+
+// Plays every voice through all blocks, writing the summed output of each
+// frame to `out` (one entry per timed frame). Returns ns per engine sample.
+template <typename T>
+static double run(const DspKernels& kernels, const Level<T>* levels, float scale, std::vector<float>& out) {
+    const PolyphaseKernel& kernel = PolyphaseKernel::get();
+    double position[VOICES] = {};
+    float pitch[VOICES];
+    for (int v = 0; v < VOICES; ++v) pitch[v] = -5.f + 7.99f * v / (VOICES - 1);
+
+    out.clear();
+    double totalNs = 0.0;
+    long frames = 0;
+    for (int b = 0; b < BLOCKS; ++b) {
+        // Rates change per block, as a slow sweep would
+        float rate[VOICES];
+        for (int v = 0; v < VOICES; ++v) rate[v] = std::exp2(pitch[v] + 0.5f * std::sin(b * 0.05f + v));
+
+        float blockOut[BLOCK_FRAMES];
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < BLOCK_FRAMES; ++n) {
+            float acc = 0.f;
+            for (int v = 0; v < VOICES; ++v) {
+                float residual = rate[v];
+                int level = 0;
+                while (residual >= 2.f && level < LEVELS - 1) { residual *= 0.5f; ++level; }
+                const Level<T>& mip = levels[level];
+                double levelPosition = position[v] * ((double)mip.length / LENGTH);
+                size_t index = std::min((size_t)levelPosition, mip.length - 1);
+                acc += read(kernels, kernel, mip.frames + index, (float)(levelPosition - index), PolyphaseKernel::getBank(residual), scale);
+                position[v] += rate[v];
+                if (position[v] >= LENGTH) position[v] = std::fmod(position[v], (double)LENGTH);
+            }
+            blockOut[n] = acc;
+        }
+        auto end = std::chrono::steady_clock::now();
+        if (b > 0) { // First block warms the caches and the kernel table
+            totalNs += std::chrono::duration<double, std::nano>(end - start).count();
+            frames += BLOCK_FRAMES;
+            out.insert(out.end(), blockOut, blockOut + BLOCK_FRAMES);
+        }
+    }
+    return totalNs / frames;
+}
+
+// Error relative to the sample's own peak, per voice (outputs are sums of VOICES voices)
+static double getErrorDb(const std::vector<float>& out, const std::vector<float>& reference, float peak) {
+    double maxError = 0.0;
+    for (size_t i = 0; i < out.size(); ++i) maxError = std::max(maxError, (double)std::fabs(out[i] - reference[i]));
+    return 20.0 * std::log10(std::max(maxError / VOICES / peak, 1e-12));
+}
+
+static bool report(const char* kernels, const char* format, size_t bytesPerFrame, double nsPerSample, double errorDb) {
+    double nsPerVoice = nsPerSample / VOICES;
+    double cpuPercent = nsPerSample * ENGINE_RATE * 1e-9 * 100.0;
+    bool pass = nsPerSample <= BUDGET_NS_PER_SAMPLE;
+    printf("bench=interpolator kernels=%s format=%s voices=%d taps=%d bytes_per_frame=%zu ns_per_sample=%.2f ns_per_voice=%.2f cpu_percent_48k=%.3f max_error_db=%.1f budget_ns=%.2f result=%s\n",
+        kernels, format, VOICES, INTERP_TAPS, bytesPerFrame, nsPerSample, nsPerVoice, cpuPercent, errorDb, BUDGET_NS_PER_SAMPLE, pass ? "pass" : "fail");
+    return pass;
+}
+
+int main() {
+    // Noise stands in for the sample; the content doesn't affect the cost.
+    // The int16 copy is scaled to the float peak the way SamplePool compacts.
+    Level<float> levels[LEVELS];
+    Level<int16_t> compactLevels[LEVELS];
+    srand(1);
+    float peak = 0.f;
+    for (int l = 0; l < LEVELS; ++l) {
+        levels[l].length = LENGTH >> l;
+        levels[l].buffer.resize(levels[l].length + 2 * GUARD);
+        for (float& x : levels[l].buffer) {
+            x = (float)rand() / RAND_MAX * 2.f - 1.f;
+            peak = std::max(peak, std::fabs(x));
+        }
+        levels[l].frames = levels[l].buffer.data() + GUARD;
+    }
+    float scale = peak / 32767.f;
+    for (int l = 0; l < LEVELS; ++l) {
+        compactLevels[l].length = levels[l].length;
+        compactLevels[l].buffer.resize(levels[l].buffer.size());
+        for (size_t i = 0; i < levels[l].buffer.size(); ++i)
+            compactLevels[l].buffer[i] = (int16_t)std::max(-32767.f, std::min(32767.f, std::round(levels[l].buffer[i] / scale)));
+        compactLevels[l].frames = compactLevels[l].buffer.data() + GUARD;
+    }
+
+    // The baseline float32 output is the reference for every other run
+    std::vector<const DspKernels*> supported = DspKernels::getSupported();
+    std::vector<float> reference, out;
+    bool pass = true;
+    for (const DspKernels* kernels : supported) {
+        double ns = run(*kernels, levels, 1.f, out);
+        if (reference.empty()) reference = out;
+        pass = report(kernels->name, "float32", sizeof(float), ns, getErrorDb(out, reference, peak)) && pass;
+        ns = run(*kernels, compactLevels, scale, out);
+        pass = report(kernels->name, "int16", sizeof(int16_t), ns, getErrorDb(out, reference, peak)) && pass;
+    }
+    return pass ? 0 : 1;
+}
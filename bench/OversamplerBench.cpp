@@ -0,0 +1,85 @@
+// --- Wend Oversampler Benchmark ---
+// Times the half-band oversampler around Wend's soft clipper for every
+// factor, with four voices in float_4 lanes as a poly Wend runs it, and
+// measures how far a 5 kHz tone driven hard folds back below it. Only the
+// header-only SDK simd types are used:
+//   make bench RACK_DIR=<path to Rack SDK>
+// Prints one key=value line per factor.
+#include "dsp/Oversampler.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using rack::simd::float_4;
+
+static const float ENGINE_RATE = 48000.f;
+static const int BLOCKS = 200;
+static const int BLOCK_FRAMES = 1024;
+
+// Strongest non-harmonic component below 20 kHz (audible aliasing) relative to the fundamental, in dB
+static double measureAliasing(int factor) {
+    const int N = 8192;
+    const double freq = 5000.0;
+    HalfbandOversampler<float> oversampler;
+    oversampler.setFactor(factor);
+    SoftClipShaper shaper;
+    shaper.setGain(8.f);
+    std::vector<float> out(N);
+    for (int n = 0; n < 2 * N; ++n) {
+        float y = oversampler.process((float)std::sin(2.0 * M_PI * freq * n / ENGINE_RATE), shaper);
+        if (n >= N) out[n - N] = y; // Skip the filter warm-up
+    }
+    // Hann-windowed DFT over every bin up to Nyquist
+    double fundamental = 0.0, worst = 0.0;
+    for (int k = 1; k < N / 2; ++k) {
+        double re = 0.0, im = 0.0;
+        for (int n = 0; n < N; ++n) {
+            double w = 0.5 - 0.5 * std::cos(2.0 * M_PI * n / N);
+            double a = 2.0 * M_PI * k * n / N;
+            re += out[n] * w * std::cos(a);
+            im -= out[n] * w * std::sin(a);
+        }
+        double power = re * re + im * im;
+        double binFreq = (double)k * ENGINE_RATE / N;
+        double harmonic = binFreq / freq;
+        bool isHarmonic = std::fabs(harmonic - std::round(harmonic)) * freq < 4.0 * ENGINE_RATE / N;
+        if (std::fabs(binFreq - freq) < 4.0 * ENGINE_RATE / N) fundamental = std::max(fundamental, power);
+        else if (!isHarmonic && binFreq < 20000.0) worst = std::max(worst, power);
+    }
+    return 10.0 * std::log10(worst / fundamental);
+}
+
+int main() {
+    const int factors[] = {1, 2, 4, 8};
+    for (int factor : factors) {
+        HalfbandOversampler<float_4> oversampler;
+        oversampler.setFactor(factor);
+        SoftClipShaper shaper;
+        shaper.setGain(4.f);
+        float_4 phase = {0.f, 0.1f, 0.2f, 0.3f};
+        float_4 acc = 0.f;
+        double totalNs = 0.0;
+        long frames = 0;
+        for (int b = 0; b < BLOCKS; ++b) {
+            auto start = std::chrono::steady_clock::now();
+            for (int n = 0; n < BLOCK_FRAMES; ++n) {
+                phase += 0.01f;
+                phase -= (phase >= 1.f) & float_4(1.f);
+                acc += oversampler.process(phase - 0.5f, shaper);
+            }
+            auto end = std::chrono::steady_clock::now();
+            if (b > 0) {
+                totalNs += std::chrono::duration<double, std::nano>(end - start).count();
+                frames += BLOCK_FRAMES;
+            }
+        }
+        volatile float sink = acc[0] + acc[1] + acc[2] + acc[3];
+        (void)sink;
+        double nsPerSample = totalNs / frames;
+        printf("bench=oversampler factor=%d voices=4 ns_per_sample=%.2f cpu_percent_48k=%.3f alias_db=%.1f\n",
+            factor, nsPerSample, nsPerSample * ENGINE_RATE * 1e-9 * 100.0, measureAliasing(factor));
+    }
+    return 0;
+}
@@ -0,0 +1,354 @@
+// --- Headless process() Benchmark ---
+// Builds Lure, Thrum and Wend against the stand-in engine in bench/headless
+// and times their process() for every scenario below at 44.1, 48, 96 and
+// 192 kHz. Linux/x86 only (cycles are read from the TSC):
+//   make bench RACK_DIR=<path to Rack SDK>
+//   bench/ProcessBench [--samples N] [--filter <substring>] [--kernels sse2|avx2|avx512]
+// The DSP kernel set is chosen as the plugin's init() would, unless
+// --kernels names a lower one.
+// Run from the repo root so Thrum finds res/sounds. Each result is one line
+// of key=value pairs, so runs can be diffed or collected over time.
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+#include "rack.hpp"
+#include "Lure.hpp"
+#include "Thrum.hpp"
+#include "Wend.hpp"
+#include "dsp/Kernels.hpp"
+
+#include <chrono>
+#include <cstdarg>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <x86intrin.h>
+
+rack::Plugin* pluginInstance = nullptr;
+
+void rack::logger::log(Level level, const char* filename, int line, const char* func, const char* format, ...) {
+#ifndef TERROIR_PROFILE
+    if (level < WARN_LEVEL) return; // Keep the result lines clean; profile builds want the reports
+#endif
+    va_list args;
+    va_start(args, format);
+    std::fprintf(stderr, "[%s:%d %s] ", filename, line, func);
+    std::vfprintf(stderr, format, args);
+    std::fprintf(stderr, "\n");
+    va_end(args);
+}
+
+// Cables are patched by giving the port a channel count
+static void patch(rack::engine::Port& port, int channels, float voltage = 0.f) {
+    port.channels = channels;
+    for (int c = 0; c < channels; ++c) port.voltages[c] = voltage;
+}
+
+// Slow per-channel LFO, so CV moves the way a patched modulator would
+static float lfo(int64_t frame, int channel, float sampleRate, float hz) {
+    return std::sin(2.f * (float)M_PI * (hz * (1.f + 0.1f * channel)) * (float)frame / sampleRate);
+}
+
+struct Scenario {
+    const char* module;
+    const char* name;
+    rack::engine::Module* (*create)();
+    void (*setup)(rack::engine::Module* m);
+    // Called every CV_BLOCK frames to move the patched CV
+    void (*update)(rack::engine::Module* m, int64_t frame, float sampleRate);
+};
+
+static const int CV_BLOCK = 32;
+
+static const Scenario scenarios[] = {
+    {"Lure", "mono-default",
+        []() -> rack::engine::Module* { return new Lure; },
+        [](rack::engine::Module*) {},
+        nullptr},
+    {"Lure", "poly16-cv-fast",
+        []() -> rack::engine::Module* { return new Lure; },
+        [](rack::engine::Module* m) {
+            m->params[Lure::SPEED_PARAM].setValue(1.f);
+            for (int i = 0; i < Lure::NUM_INPUTS; ++i) patch(m->inputs[i], 16);
+            for (int i = Lure::MIN_ATTENUVERTER; i <= Lure::SPEED_ATTENUVERTER; ++i) m->params[i].setValue(0.5f);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int i = 0; i < Lure::NUM_INPUTS; ++i)
+                for (int c = 0; c < 16; ++c) m->inputs[i].voltages[c] = 5.f + 5.f * lfo(frame, c, sampleRate, 0.3f + i);
+        }},
+    {"Lure", "poly16-fast",
+        []() -> rack::engine::Module* { return new Lure; },
+        [](rack::engine::Module* m) {
+            m->params[Lure::VOICES_PARAM].setValue(16.f);
+            m->params[Lure::SPEED_PARAM].setValue(1.f);
+        },
+        nullptr},
+    {"Lure", "poly16-audio-rate",
+        []() -> rack::engine::Module* {
+            Lure* lure = new Lure;
+            lure->setAudioRate(true);
+            return lure;
+        },
+        [](rack::engine::Module* m) {
+            m->params[Lure::VOICES_PARAM].setValue(16.f);
+            m->params[Lure::SPEED_PARAM].setValue(1.f);
+        },
+        nullptr},
+    {"Lure", "poly16-audio-rate-cv",
+        []() -> rack::engine::Module* {
+            // SPEED alone moving, so the jump length keeps changing under one field
+            Lure* lure = new Lure;
+            lure->setAudioRate(true);
+            return lure;
+        },
+        [](rack::engine::Module* m) {
+            m->params[Lure::VOICES_PARAM].setValue(16.f);
+            m->params[Lure::SPEED_PARAM].setValue(1.f);
+            patch(m->inputs[Lure::SPEED_INPUT], 1);
+            m->params[Lure::SPEED_ATTENUVERTER].setValue(0.5f);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            m->inputs[Lure::SPEED_INPUT].voltages[0] = 5.f + 5.f * lfo(frame, 0, sampleRate, 0.3f);
+        }},
+    {"Lure", "poly16-mono-cv",
+        []() -> rack::engine::Module* { return new Lure; },
+        [](rack::engine::Module* m) {
+            m->params[Lure::VOICES_PARAM].setValue(16.f);
+            m->params[Lure::SPEED_PARAM].setValue(1.f);
+            for (int i = 0; i < Lure::NUM_INPUTS; ++i) patch(m->inputs[i], 1);
+            for (int i = Lure::MIN_ATTENUVERTER; i <= Lure::SPEED_ATTENUVERTER; ++i) m->params[i].setValue(0.5f);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int i = 0; i < Lure::NUM_INPUTS; ++i) m->inputs[i].voltages[0] = 5.f + 5.f * lfo(frame, 0, sampleRate, 0.3f + i);
+        }},
+    {"Lure", "poly16-coupled",
+        []() -> rack::engine::Module* {
+            // Same patch as poly16-mono-cv, as one field with attraction
+            Lure* lure = new Lure;
+            lure->couplingMode = 2;
+            return lure;
+        },
+        [](rack::engine::Module* m) {
+            m->params[Lure::VOICES_PARAM].setValue(16.f);
+            m->params[Lure::SPEED_PARAM].setValue(1.f);
+            for (int i = 0; i < Lure::NUM_INPUTS; ++i) patch(m->inputs[i], 1);
+            for (int i = Lure::MIN_ATTENUVERTER; i <= Lure::SPEED_ATTENUVERTER; ++i) m->params[i].setValue(0.5f);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int i = 0; i < Lure::NUM_INPUTS; ++i) m->inputs[i].voltages[0] = 5.f + 5.f * lfo(frame, 0, sampleRate, 0.3f + i);
+        }},
+    {"Lure", "poly16-unpatched",
+        []() -> rack::engine::Module* { return new Lure; },
+        [](rack::engine::Module* m) {
+            m->params[Lure::VOICES_PARAM].setValue(16.f);
+            patch(m->outputs[Lure::CV_OUTPUT], 0);
+        },
+        nullptr},
+    {"Thrum", "mono-free",
+        []() -> rack::engine::Module* { return new Thrum; },
+        [](rack::engine::Module*) {},
+        nullptr},
+    {"Thrum", "poly16-clock-cv",
+        []() -> rack::engine::Module* { return new Thrum; },
+        [](rack::engine::Module* m) {
+            patch(m->inputs[Thrum::CLOCK_INPUT], 16);
+            patch(m->inputs[Thrum::DURATION_CV_INPUT], 16);
+            patch(m->inputs[Thrum::DUTY_CV_INPUT], 16);
+            patch(m->inputs[Thrum::BIAS_CV_INPUT], 16);
+            m->params[Thrum::DURATION_ATTEN_PARAM].setValue(0.5f);
+            m->params[Thrum::DUTY_ATTEN_PARAM].setValue(0.5f);
+            m->params[Thrum::BIAS_ATTEN_PARAM].setValue(0.5f);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int c = 0; c < 16; ++c) {
+                // Eighth notes at 120 BPM, staggered per channel
+                int64_t period = (int64_t)(sampleRate / 4.f);
+                m->inputs[Thrum::CLOCK_INPUT].voltages[c] = ((frame + c * period / 16) % period < period / 2) ? 10.f : 0.f;
+                m->inputs[Thrum::DURATION_CV_INPUT].voltages[c] = 5.f * lfo(frame, c, sampleRate, 0.2f);
+                m->inputs[Thrum::DUTY_CV_INPUT].voltages[c] = 5.f * lfo(frame, c, sampleRate, 0.3f);
+                m->inputs[Thrum::BIAS_CV_INPUT].voltages[c] = 5.f * lfo(frame, c, sampleRate, 0.5f);
+            }
+        }},
+    {"Thrum", "poly16-clock-resting",
+        []() -> rack::engine::Module* { return new Thrum; },
+        [](rack::engine::Module* m) {
+            // Clock patched but never fires: every envelope rests at 0 V
+            patch(m->inputs[Thrum::CLOCK_INPUT], 16);
+            patch(m->inputs[Thrum::PITCH_INPUT], 16);
+        },
+        nullptr},
+    {"Thrum", "poly16-pitch",
+        []() -> rack::engine::Module* { return new Thrum; },
+        [](rack::engine::Module* m) {
+            patch(m->inputs[Thrum::PITCH_INPUT], 16);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            // Voices spread over four octaves with a slow vibrato
+            for (int c = 0; c < 16; ++c)
+                m->inputs[Thrum::PITCH_INPUT].voltages[c] = -2.f + 4.f * c / 15.f + 0.05f * lfo(frame, c, sampleRate, 5.f);
+        }},
+    {"Thrum", "poly16-pitch-compact",
+        []() -> rack::engine::Module* {
+            // 16-bit resident frames; set before the first acquire
+            Thrum* thrum = new Thrum;
+            thrum->setCompactSamples(true);
+            return thrum;
+        },
+        [](rack::engine::Module* m) {
+            patch(m->inputs[Thrum::PITCH_INPUT], 16);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int c = 0; c < 16; ++c)
+                m->inputs[Thrum::PITCH_INPUT].voltages[c] = -2.f + 4.f * c / 15.f + 0.05f * lfo(frame, c, sampleRate, 5.f);
+        }},
+    {"Thrum", "poly16-vca",
+        []() -> rack::engine::Module* { return new Thrum; },
+        [](rack::engine::Module* m) {
+            patch(m->inputs[Thrum::AUDIO_INPUT], 16);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int c = 0; c < 16; ++c) m->inputs[Thrum::AUDIO_INPUT].voltages[c] = 5.f * lfo(frame, c, sampleRate, 110.f);
+        }},
+    {"Thrum", "poly16-overlap-8",
+        []() -> rack::engine::Module* {
+            Thrum* thrum = new Thrum;
+            thrum->voiceCount = 8;
+            return thrum;
+        },
+        [](rack::engine::Module* m) {
+            // 3 s envelopes on an eighth-note clock: the pool fills and steals
+            patch(m->inputs[Thrum::CLOCK_INPUT], 16);
+            patch(m->inputs[Thrum::PITCH_INPUT], 16);
+            m->params[Thrum::TOTAL_DURATION_PARAM].setValue(1.f);
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            int64_t period = (int64_t)(sampleRate / 4.f);
+            for (int c = 0; c < 16; ++c) {
+                m->inputs[Thrum::CLOCK_INPUT].voltages[c] = ((frame + c * period / 16) % period < period / 2) ? 10.f : 0.f;
+                m->inputs[Thrum::PITCH_INPUT].voltages[c] = -2.f + 4.f * c / 15.f + 0.05f * lfo(frame, c, sampleRate, 5.f);
+            }
+        }},
+    {"Wend", "mono-1x",
+        []() -> rack::engine::Module* { return new Wend; },
+        [](rack::engine::Module* m) {
+            m->params[Wend::FREQ_PARAM].setValue(440.f);
+            static_cast<Wend*>(m)->oversampleFactor = 1;
+        },
+        nullptr},
+    {"Wend", "poly16-fm-4x",
+        []() -> rack::engine::Module* { return new Wend; },
+        [](rack::engine::Module* m) {
+            m->params[Wend::FREQ_PARAM].setValue(220.f);
+            m->params[Wend::SHAPE_PARAM].setValue(0.5f);
+            m->params[Wend::DRIVE_PARAM].setValue(0.5f);
+            m->params[Wend::FM_PARAM].setValue(0.5f);
+            patch(m->inputs[Wend::VOCT_INPUT], 16);
+            patch(m->inputs[Wend::FM_INPUT], 16);
+            static_cast<Wend*>(m)->oversampleFactor = 4;
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int c = 0; c < 16; ++c) {
+                m->inputs[Wend::VOCT_INPUT].voltages[c] = c / 4.f;
+                m->inputs[Wend::FM_INPUT].voltages[c] = 5.f * lfo(frame, c, sampleRate, 3.f);
+            }
+        }},
+    {"Wend", "poly16-fm-8x",
+        []() -> rack::engine::Module* { return new Wend; },
+        [](rack::engine::Module* m) {
+            m->params[Wend::FREQ_PARAM].setValue(220.f);
+            m->params[Wend::SHAPE_PARAM].setValue(0.5f);
+            m->params[Wend::DRIVE_PARAM].setValue(0.5f);
+            m->params[Wend::FM_PARAM].setValue(0.5f);
+            patch(m->inputs[Wend::VOCT_INPUT], 16);
+            patch(m->inputs[Wend::FM_INPUT], 16);
+            static_cast<Wend*>(m)->oversampleFactor = 8;
+        },
+        [](rack::engine::Module* m, int64_t frame, float sampleRate) {
+            for (int c = 0; c < 16; ++c) {
+                m->inputs[Wend::VOCT_INPUT].voltages[c] = c / 4.f;
+                m->inputs[Wend::FM_INPUT].voltages[c] = 5.f * lfo(frame, c, sampleRate, 3.f);
+            }
+        }},
+    {"Wend", "poly16-unpatched",
+        []() -> rack::engine::Module* { return new Wend; },
+        [](rack::engine::Module* m) {
+            patch(m->inputs[Wend::VOCT_INPUT], 16);
+            patch(m->outputs[Wend::AUDIO_OUTPUT], 0);
+        },
+        nullptr},
+};
+
+// Thrum's samples load on the pool's worker; timing starts once they are in
+static void waitForSamples(rack::engine::Module* m) {
+    Thrum* thrum = dynamic_cast<Thrum*>(m);
+    if (!thrum) return;
+    for (int tries = 0; tries < 10000; ++tries) {
+        bool ready = true;
+        for (const SampleHandle& sample : thrum->loadedSamples) ready = ready && sample && sample->isReady();
+        if (ready) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::fprintf(stderr, "Thrum samples did not load; timing silent playback\n");
+}
+
+int main(int argc, char** argv) {
+    int64_t samples = 2000000;
+    const char* filter = nullptr;
+    const char* kernelsName = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--samples") && i + 1 < argc) samples = std::atoll(argv[++i]);
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--kernels") && i + 1 < argc) kernelsName = argv[++i];
+    }
+    const char* kernels = DspKernels::select(kernelsName).name;
+    const float sampleRates[] = {44100.f, 48000.f, 96000.f, 192000.f};
+
+    for (const Scenario& scenario : scenarios) {
+        std::string id = std::string(scenario.module) + "/" + scenario.name;
+        if (filter && id.find(filter) == std::string::npos) continue;
+        for (float sampleRate : sampleRates) {
+            std::unique_ptr<rack::engine::Module> m(scenario.create());
+            for (rack::engine::Output& output : m->outputs) patch(output, 1);
+            scenario.setup(m.get());
+            rack::engine::Module::SampleRateChangeEvent e;
+            e.sampleRate = sampleRate;
+            e.sampleTime = 1.f / sampleRate;
+            m->onSampleRateChange(e);
+            waitForSamples(m.get());
+
+            rack::engine::Module::ProcessArgs args;
+            args.sampleRate = sampleRate;
+            args.sampleTime = 1.f / sampleRate;
+            args.frame = 0;
+            // One second of warm-up to settle caches, tables and envelopes
+            int64_t warmup = (int64_t)sampleRate;
+            double ns = 0.0;
+            uint64_t cycles = 0;
+            float sink = 0.f;
+            for (int64_t frame = 0; frame < warmup + samples; frame += CV_BLOCK) {
+                if (scenario.update) scenario.update(m.get(), frame, sampleRate);
+                auto start = std::chrono::steady_clock::now();
+                uint64_t startCycles = __rdtsc();
+                for (int n = 0; n < CV_BLOCK; ++n) {
+                    args.frame = frame + n;
+                    m->process(args);
+                }
+                uint64_t endCycles = __rdtsc();
+                auto end = std::chrono::steady_clock::now();
+                if (frame >= warmup) {
+                    ns += std::chrono::duration<double, std::nano>(end - start).count();
+                    cycles += endCycles - startCycles;
+                }
+                sink += m->outputs[0].voltages[0];
+            }
+            int64_t timed = ((warmup + samples + CV_BLOCK - 1) / CV_BLOCK - (warmup + CV_BLOCK - 1) / CV_BLOCK) * CV_BLOCK;
+            std::printf("bench=process module=%s scenario=%s kernels=%s rate=%.0f samples=%lld ns_per_sample=%.2f cycles_per_sample=%.1f cpu_percent=%.3f checksum=%g\n",
+                scenario.module, scenario.name, kernels, sampleRate, (long long)timed, ns / timed, (double)cycles / timed,
+                ns / timed * sampleRate * 1e-9 * 100.0, sink);
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,3 @@
+#pragma once
+// Headless stand-in: everything lives in rack.hpp
+#include "rack.hpp"
@@ -0,0 +1,27 @@
+#pragma once
+// --- Headless jansson Stand-in ---
+// The benchmark and renderer never save or load patches, but the modules'
+// dataToJson() and dataFromJson() are still compiled. These no-op versions
+// of the calls they make let the build skip linking jansson.
+#include <cstdint>
+
+typedef struct json_t json_t;
+typedef long long json_int_t;
+
+inline json_t* json_object() { return nullptr; }
+inline json_t* json_array() { return nullptr; }
+inline json_t* json_string(const char*) { return nullptr; }
+inline json_t* json_integer(json_int_t) { return nullptr; }
+inline json_t* json_real(double) { return nullptr; }
+inline json_t* json_boolean(int) { return nullptr; }
+inline json_t* json_object_get(const json_t*, const char*) { return nullptr; }
+inline int json_object_set_new(json_t*, const char*, json_t*) { return -1; }
+inline json_t* json_array_get(const json_t*, size_t) { return nullptr; }
+inline size_t json_array_size(const json_t*) { return 0; }
+inline int json_array_append_new(json_t*, json_t*) { return -1; }
+inline const char* json_string_value(const json_t*) { return nullptr; }
+inline json_int_t json_integer_value(const json_t*) { return 0; }
+inline double json_real_value(const json_t*) { return 0.0; }
+inline double json_number_value(const json_t*) { return 0.0; }
+inline int json_is_true(const json_t*) { return 0; }
+inline void json_decref(json_t*) {}
@@ -0,0 +1,359 @@
+#pragma once
+// --- Headless Rack Stand-in ---
+// Just enough of the Rack engine API to build Terroir's modules (with
+// TERROIR_HEADLESS defined, which drops their widgets) into a plain Linux
+// executable. The header-only parts of the SDK are used as-is: common,
+// math and the simd types, so the DSP code compiles exactly as in the
+// plugin. Everything else here is a minimal reimplementation. Used by
+// bench/ProcessBench.cpp and the offline renderer, tools/Render.cpp.
+#include <common.hpp>
+#include <math.hpp>
+#include <simd/Vector.hpp>
+#include <simd/functions.hpp>
+#include <jansson.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace rack {
+
+namespace plugin {
+struct Plugin {};
+struct Model {};
+}
+
+namespace engine {
+
+struct Module;
+
+struct Param {
+    float value = 0.f;
+    float getValue() { return value; }
+    void setValue(float v) { value = v; }
+};
+
+struct Port {
+    float voltages[16] = {};
+    uint8_t channels = 0;
+
+    void setVoltage(float voltage, int channel = 0) { voltages[channel] = voltage; }
+    float getVoltage(int channel = 0) { return voltages[channel]; }
+    float getPolyVoltage(int channel) { return isMonophonic() ? getVoltage(0) : getVoltage(channel); }
+    float getVoltageSum() {
+        float sum = 0.f;
+        for (int c = 0; c < channels; ++c) sum += voltages[c];
+        return sum;
+    }
+    template <typename T>
+    T getVoltageSimd(int firstChannel) { return T::load(&voltages[firstChannel]); }
+    template <typename T>
+    T getPolyVoltageSimd(int firstChannel) { return isMonophonic() ? T(getVoltage(0)) : getVoltageSimd<T>(firstChannel); }
+    template <typename T>
+    void setVoltageSimd(T voltage, int firstChannel) { voltage.store(&voltages[firstChannel]); }
+    float* getVoltages(int firstChannel = 0) { return &voltages[firstChannel]; }
+
+    // As in Rack, setting 0 channels on an output is clamped to 1
+    void setChannels(int n) {
+        if (channels == 0) return;
+        for (int c = n; c < channels; ++c) voltages[c] = 0.f;
+        channels = std::max(n, 1);
+    }
+    int getChannels() { return channels; }
+    bool isConnected() { return channels > 0; }
+    bool isMonophonic() { return channels == 1; }
+    bool isPolyphonic() { return channels > 1; }
+};
+
+struct Input : Port {};
+struct Output : Port {};
+
+struct Light {
+    float value = 0.f;
+    void setBrightness(float brightness) { value = brightness; }
+    float getBrightness() { return value; }
+};
+
+struct PortInfo {
+    std::string name;
+};
+
+struct ParamQuantity {
+    Module* module = nullptr;
+    int paramId = -1;
+    float minValue = 0.f;
+    float maxValue = 1.f;
+    float defaultValue = 0.f;
+    std::string name;
+    std::string unit;
+    bool snapEnabled = false;
+
+    virtual ~ParamQuantity() {}
+    float getValue();
+    void setValue(float value);
+    virtual std::string getDisplayValueString() { return std::to_string(getValue()); }
+};
+
+struct SwitchQuantity : ParamQuantity {
+    std::vector<std::string> labels;
+};
+
+struct Module {
+    int64_t id = -1;
+    std::vector<Param> params;
+    std::vector<Input> inputs;
+    std::vector<Output> outputs;
+    std::vector<Light> lights;
+    std::vector<ParamQuantity*> paramQuantities;
+    std::vector<PortInfo*> inputInfos;
+    std::vector<PortInfo*> outputInfos;
+
+    struct ProcessArgs {
+        float sampleRate;
+        float sampleTime;
+        int64_t frame;
+    };
+    struct SampleRateChangeEvent {
+        float sampleRate;
+        float sampleTime;
+    };
+    struct SaveEvent {};
+
+    virtual ~Module() {
+        for (ParamQuantity* q : paramQuantities) delete q;
+        for (PortInfo* info : inputInfos) delete info;
+        for (PortInfo* info : outputInfos) delete info;
+    }
+
+    void config(int numParams, int numInputs, int numOutputs, int numLights = 0) {
+        params.resize(numParams);
+        inputs.resize(numInputs);
+        outputs.resize(numOutputs);
+        lights.resize(numLights);
+        paramQuantities.resize(numParams, nullptr);
+        inputInfos.resize(numInputs, nullptr);
+        outputInfos.resize(numOutputs, nullptr);
+    }
+
+    template <class TParamQuantity = ParamQuantity>
+    TParamQuantity* configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string name = "", std::string unit = "", float /*displayBase*/ = 0.f, float /*displayMultiplier*/ = 1.f, float /*displayOffset*/ = 0.f) {
+        delete paramQuantities[paramId];
+        TParamQuantity* q = new TParamQuantity;
+        q->module = this;
+        q->paramId = paramId;
+        q->minValue = minValue;
+        q->maxValue = maxValue;
+        q->defaultValue = defaultValue;
+        q->name = name;
+        q->unit = unit;
+        paramQuantities[paramId] = q;
+        params[paramId].value = defaultValue;
+        return q;
+    }
+
+    template <class TSwitchQuantity = SwitchQuantity>
+    TSwitchQuantity* configSwitch(int paramId, float minValue, float maxValue, float defaultValue, std::string name = "", std::vector<std::string> labels = {}) {
+        TSwitchQuantity* q = configParam<TSwitchQuantity>(paramId, minValue, maxValue, defaultValue, name);
+        q->snapEnabled = true;
+        q->labels = labels;
+        return q;
+    }
+
+    PortInfo* configInput(int portId, std::string name = "") {
+        delete inputInfos[portId];
+        inputInfos[portId] = new PortInfo{name};
+        return inputInfos[portId];
+    }
+
+    PortInfo* configOutput(int portId, std::string name = "") {
+        delete outputInfos[portId];
+        outputInfos[portId] = new PortInfo{name};
+        return outputInfos[portId];
+    }
+
+    ParamQuantity* getParamQuantity(int paramId) { return paramQuantities[paramId]; }
+
+    // Under build/bench/patch, standing in for the autosave folder
+    std::string getPatchStorageDirectory() { return "build/bench/patch/modules/" + std::to_string(id); }
+    std::string createPatchStorageDirectory();
+
+    virtual void process(const ProcessArgs&) {}
+    virtual void onReset() {}
+    virtual void onSampleRateChange(const SampleRateChangeEvent&) {}
+    virtual void onSave(const SaveEvent&) {}
+    virtual json_t* dataToJson() { return nullptr; }
+    virtual void dataFromJson(json_t*) {}
+};
+
+inline float ParamQuantity::getValue() { return module->params[paramId].getValue(); }
+inline void ParamQuantity::setValue(float value) { module->params[paramId].setValue(math::clamp(value, minValue, maxValue)); }
+
+} // namespace engine
+
+namespace app {}
+
+namespace random {
+// xoshiro128+ with a fixed seed, so runs are comparable. Per thread, as in
+// Rack, so renderer jobs on different threads don't share (or race on) it.
+inline uint32_t* state() {
+    static thread_local uint32_t s[4] = {0x9e3779b9u, 0x243f6a88u, 0xb7e15162u, 0x7f4a7c15u};
+    return s;
+}
+// Not in Rack, which seeds from the clock: lets a render be repeated exactly
+inline void seed(uint64_t value) {
+    uint32_t* s = state();
+    for (int i = 0; i < 4; ++i) {
+        // splitmix64, so nearby seeds start far apart
+        uint64_t z = (value += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        s[i] = (uint32_t)((z ^ (z >> 31)) >> 32);
+    }
+}
+inline uint32_t u32() {
+    uint32_t* s = state();
+    uint32_t result = s[0] + s[3];
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+    return result;
+}
+inline uint64_t u64() { return ((uint64_t)u32() << 32) | u32(); }
+inline float uniform() { return (u32() >> 8) * (1.f / 16777216.f); }
+inline float normal() {
+    float u = std::max(uniform(), 1e-7f);
+    return std::sqrt(-2.f * std::log(u)) * std::cos(2.f * (float)M_PI * uniform());
+}
+}
+
+namespace dsp {
+
+// Same scheme as the SDK approximation: 2^floor(x) built in the exponent
+// bits, fifth-order polynomial for the fraction. Valid for |x| < 126.
+inline simd::float_4 exp2_taylor5(simd::float_4 x) {
+    simd::float_4 xi = simd::floor(x);
+    simd::float_4 xf = x - xi;
+    __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(xi.v), _mm_set1_epi32(127)), 23);
+    simd::float_4 yi(_mm_castsi128_ps(bits));
+    simd::float_4 yf = 1.f + xf * (0.6931471805f + xf * (0.2402265069f + xf * (0.0555041086f + xf * (0.0096181291f + xf * 0.0013333558f))));
+    return yi * yf;
+}
+inline float exp2_taylor5(float x) {
+    return exp2_taylor5(simd::float_4(x))[0];
+}
+
+// Power-of-two real FFT with the SDK's ordered layout: [DC, Nyquist, re(1), im(1), ...].
+// irfft is unscaled, so irfft(rfft(x)) = length * x.
+struct RealFFT {
+    size_t length;
+    explicit RealFFT(size_t length) : length(length) {}
+
+    void rfft(const float* input, float* output) {
+        std::vector<std::complex<double>> x(input, input + length);
+        transform(x, false);
+        output[0] = (float)x[0].real();
+        output[1] = (float)x[length / 2].real();
+        for (size_t k = 1; k < length / 2; ++k) {
+            output[2 * k] = (float)x[k].real();
+            output[2 * k + 1] = (float)x[k].imag();
+        }
+    }
+
+    void irfft(const float* input, float* output) {
+        std::vector<std::complex<double>> x(length);
+        x[0] = input[0];
+        x[length / 2] = input[1];
+        for (size_t k = 1; k < length / 2; ++k) {
+            x[k] = std::complex<double>(input[2 * k], input[2 * k + 1]);
+            x[length - k] = std::conj(x[k]);
+        }
+        transform(x, true);
+        for (size_t n = 0; n < length; ++n) output[n] = (float)x[n].real();
+    }
+
+private:
+    static void transform(std::vector<std::complex<double>>& x, bool inverse) {
+        size_t n = x.size();
+        for (size_t i = 1, j = 0; i < n; ++i) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) std::swap(x[i], x[j]);
+        }
+        for (size_t len = 2; len <= n; len <<= 1) {
+            double angle = 2.0 * M_PI / len * (inverse ? 1.0 : -1.0);
+            std::complex<double> step(std::cos(angle), std::sin(angle));
+            for (size_t i = 0; i < n; i += len) {
+                std::complex<double> w(1.0);
+                for (size_t k = 0; k < len / 2; ++k) {
+                    std::complex<double> a = x[i + k];
+                    std::complex<double> b = x[i + k + len / 2] * w;
+                    x[i + k] = a + b;
+                    x[i + k + len / 2] = a - b;
+                    w *= step;
+                }
+            }
+        }
+    }
+};
+
+} // namespace dsp
+
+namespace asset {
+// Plugin assets resolve against the working directory (the repo root when run by `make bench`)
+inline std::string plugin(plugin::Plugin*, const std::string& filename) { return filename; }
+inline std::string user(const std::string& filename) { return "build/bench/user/" + filename; }
+inline std::string system(const std::string& filename) { return filename; }
+}
+
+namespace system {
+inline std::string getFilename(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return (slash == std::string::npos) ? path : path.substr(slash + 1);
+}
+inline std::string getDirectory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return (slash == std::string::npos) ? "" : path.substr(0, slash);
+}
+inline std::string getStem(const std::string& path) {
+    std::string filename = getFilename(path);
+    size_t dot = filename.find_last_of('.');
+    return (dot == std::string::npos) ? filename : filename.substr(0, dot);
+}
+inline std::string join(const std::string& path1, const std::string& path2) { return path1 + "/" + path2; }
+inline bool isFile(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+inline bool remove(const std::string& path) { return std::remove(path.c_str()) == 0; }
+inline bool createDirectories(const std::string& path) {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        mkdir(path.substr(0, slash).c_str(), 0755);
+        if (slash == std::string::npos) break;
+    }
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+}
+
+inline std::string engine::Module::createPatchStorageDirectory() {
+    std::string dir = getPatchStorageDirectory();
+    system::createDirectories(dir);
+    return dir;
+}
+
+using namespace math;
+using namespace engine;
+using plugin::Plugin;
+using plugin::Model;
+
+} // namespace rack
@@ -1,21 +1,24 @@
-#define DR_WAV_IMPLEMENTATION
-#include "dr_wav.h" 
-#include <rack.hpp>
-#include "Lure.hpp"
-#include "Thrum.hpp"
-#include "Wend.hpp"
-
-using namespace rack;
-
-Model* modelLure;
-Model* modelThrum;
-Model* modelWend;
-
-rack::Plugin* pluginInstance = nullptr;
-
-extern "C" void init(Plugin* p) {
-    pluginInstance = p;
-    p->addModel(createModel<Lure, LureWidget>("Lure"));
-    p->addModel(createModel<Thrum, ThrumWidget>("Thrum"));
-    p->addModel(createModel<Wend, WendWidget>("Wend"));
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h" 
+#include <rack.hpp>
+#include "Lure.hpp"
+#include "Thrum.hpp"
+#include "Wend.hpp"
+#include "dsp/Kernels.hpp"
+
+using namespace rack;
+
+Model* modelLure;
+Model* modelThrum;
+Model* modelWend;
+
+rack::Plugin* pluginInstance = nullptr;
+
+extern "C" void init(Plugin* p) {
+    pluginInstance = p;
+    // Pick the widest DSP kernels this CPU runs before any module exists
+    INFO("Terroir DSP kernels: %s", DspKernels::select().name);
+    p->addModel(createModel<Lure, LureWidget>("Lure"));
+    p->addModel(createModel<Thrum, ThrumWidget>("Thrum"));
+    p->addModel(createModel<Wend, WendWidget>("Wend"));
 }
\ No newline at end of file
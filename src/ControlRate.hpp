@@ -0,0 +1,101 @@
+#pragma once
+
+#include <rack.hpp>
+#include <atomic>
+
+// --- Control-rate Parameter Pipeline ---
+// Knobs and CV move at control speed, so the modules read params and CV,
+// apply attenuverters and run their pow/log mappings once per control block
+// instead of every sample. Audio-rate code only sees the mapped results,
+// stepped or ramped across the block by ControlSmoother. The block length
+// is per module instance, chosen from the context menu and saved with the
+// patch; a length of 1 restores per-sample evaluation.
+
+static const int CONTROL_RATE_DIVISIONS[] = {1, 4, 16, 32, 64};
+static const int CONTROL_RATE_DIVISION_COUNT = 5;
+static const int CONTROL_RATE_DEFAULT = 16;
+
+struct ControlRate {
+    std::atomic<int> division{CONTROL_RATE_DEFAULT}; // Samples per control block; written by the UI thread
+    int remaining = 0;
+    int blockLength = 1; // Length of the block started by the last tick()
+
+    // True on the first sample of each control block
+    bool tick() {
+        if (remaining > 0) {
+            --remaining;
+            return false;
+        }
+        blockLength = division.load(std::memory_order_relaxed);
+        remaining = blockLength - 1;
+        return true;
+    }
+
+    // Makes the next sample start a new block, e.g. after a reset or load
+    void invalidate() { remaining = 0; }
+
+    void dataToJson(json_t* rootJ) const {
+        json_object_set_new(rootJ, "controlRate", json_integer(division.load()));
+    }
+
+    void dataFromJson(json_t* rootJ) {
+        json_t* divisionJ = json_object_get(rootJ, "controlRate");
+        if (!divisionJ) return;
+        int value = (int)json_integer_value(divisionJ);
+        for (int i = 0; i < CONTROL_RATE_DIVISION_COUNT; ++i)
+            if (CONTROL_RATE_DIVISIONS[i] == value) division = value;
+        invalidate();
+    }
+};
+
+// Linear ramp to each new control value over one block, so mapped values
+// that feed audio directly don't step. The first target is taken as-is, and
+// an unchanged target doesn't ramp at all.
+struct ControlSmoother {
+    float value = 0.f;
+    float target = 0.f;
+    float step = 0.f;
+    int remaining = 0;
+    bool primed = false;
+
+    void setTarget(float newTarget, int samples) {
+        target = newTarget;
+        if (!primed || samples <= 1 || target == value) {
+            value = target;
+            remaining = 0;
+            primed = true;
+            return;
+        }
+        step = (target - value) / samples;
+        remaining = samples;
+    }
+
+    bool isRamping() const { return remaining > 0; }
+
+    float process() {
+        if (remaining > 0) {
+            // Land exactly on the target at the end of the block
+            value = (--remaining == 0) ? target : value + step;
+        }
+        return value;
+    }
+
+    void reset() { primed = false; remaining = 0; }
+};
+
+#ifndef TERROIR_HEADLESS
+inline void appendControlRateMenu(rack::ui::Menu* menu, ControlRate* controlRate) {
+    menu->addChild(rack::createIndexSubmenuItem("Control rate",
+        {"Every sample", "Every 4 samples", "Every 16 samples", "Every 32 samples", "Every 64 samples"},
+        [=]() {
+            int division = controlRate->division.load();
+            size_t index = 0;
+            while (index < CONTROL_RATE_DIVISION_COUNT - 1 && CONTROL_RATE_DIVISIONS[index] < division) ++index;
+            return index;
+        },
+        [=](size_t index) {
+            controlRate->division = CONTROL_RATE_DIVISIONS[index];
+        }
+    ));
+}
+#endif
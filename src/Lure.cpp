@@ -1,219 +1,465 @@
-#include "Lure.hpp"
-#include "rack.hpp"
-#include "componentlibrary.hpp"
-#include "widgets/Magpie125.hpp"
-#include "widgets/Song60.hpp"
-
-
-// ----------------------------------------------
-// Tunable constants for behavior shaping
-// ----------------------------------------------
-constexpr float VOLTAGE_MIN = -5.f;
-constexpr float VOLTAGE_MAX = 10.f;
-
-constexpr float ATTENUVERTER_RANGE = 1.f;
-constexpr float KNOB_BIAS_DEFAULT = 0.5f;
-constexpr float KNOB_PULL_DEFAULT = 0.5f;
-constexpr float KNOB_SPEED_DEFAULT = 0.5f;
-
-constexpr float STEP_SIZE = 0.05f;             // Fixed movement per step
-constexpr float EPSILON = 1e-3f;               // Prevent division by zero at edges
-constexpr float EDGE_REPEL_FACTOR = 0.03f;
-constexpr float EDGE_EXPONENT = 1.51f;
-
-constexpr float SPEED_EXPONENT = 1.f;          // Speed curve shape
-constexpr float SPEED_INTERVAL_MIN_MS = 0.1f;     // or lower if needed
-constexpr float SPEED_INTERVAL_MAX_MS = 1000.f;
-
-constexpr float PULL_EXPONENT = 2.0f;          // Perceptual pull shaping
-constexpr float GRAVITY_EXPONENT = 2.5f;       // Distance-squared-ish gravity curve
-
-constexpr float LED_RANGE_NORM = 10.f;         // Range scale for LED normalization
-
-using namespace rack;
-using namespace rack::app;
-
-Lure::Lure() {
-    config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, 0);
-    
-    configParam(MIN_PARAM, -5.f, 10.f, 0.f, "Minimum output voltage");
-    configParam(MAX_PARAM, -5.f, 10.f, 10.f, "Maximum output voltage");
-    configParam(BIAS_PARAM, 0.f, 1.f, 0.5f, "Bias\nDrift center between Min and Max");
-    configParam(PULL_PARAM, 0.f, 1.f, 0.5f, "Pull\nGravity toward center\n0 = free walk, 1 = strongly centered");
-    configParam(SPEED_PARAM, 0.f, 1.f, 0.5f, "Speed\nDrift speed\n0 = slow, 1 = fast");
-    
-    configParam(MIN_ATTENUVERTER, -1.f, 1.f, 0.f, "Min Attenuverter");
-    configParam(MAX_ATTENUVERTER, -1.f, 1.f, 0.f, "Max Attenuverter");
-    configParam(BIAS_ATTENUVERTER, -1.f, 1.f, 0.f, "Bias Attenuverter");
-    configParam(PULL_ATTENUVERTER, -1.f, 1.f, 0.f, "Pull Attenuverter");
-    configParam(SPEED_ATTENUVERTER, -1.f, 1.f, 0.f, "Speed Attenuverter");
-}
-
-LureWidget::LureWidget(Lure* module) {
-    setModule(module);
-    setPanel(createPanel(asset::plugin(pluginInstance, "res/Lure.svg")));
-
-		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 20)), module, Lure::MIN_PARAM));
-        addParam(createParamCentered<Song60>(mm2px(Vec(23, 22.25)), module, Lure::MIN_ATTENUVERTER));
-        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 22.33)), module, Lure::MIN_INPUT));
-
-		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 39)), module, Lure::MAX_PARAM));
-        addParam(createParamCentered<Song60>(mm2px(Vec(23, 41.25)), module, Lure::MAX_ATTENUVERTER));
-        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 41.33)), module, Lure::MAX_INPUT));    
-
-		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 58)), module, Lure::BIAS_PARAM));
-        addParam(createParamCentered<Song60>(mm2px(Vec(23, 60.25)), module, Lure::BIAS_ATTENUVERTER));
-        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 60.33)), module, Lure::BIAS_INPUT));
-        
-		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 77)), module, Lure::PULL_PARAM));
-        addParam(createParamCentered<Song60>(mm2px(Vec(23, 79.25)), module, Lure::PULL_ATTENUVERTER));
-        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 79.33)), module, Lure::PULL_INPUT));
-
-		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 96)), module, Lure::SPEED_PARAM));
-        addParam(createParamCentered<Song60>(mm2px(Vec(23, 98.25)), module, Lure::SPEED_ATTENUVERTER));
-        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 98.33)), module, Lure::SPEED_INPUT));
-
-        addOutput(createOutputCentered<componentlibrary::PJ301MPort>(mm2px(math::Vec(20.32,110)), module, Lure::CV_OUTPUT));
-
-		addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
-		addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
-		addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-		addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-}
-
-float Lure::getModulatedMin() {
-	float min = params[MIN_PARAM].getValue();
-	if (inputs[MIN_INPUT].isConnected()) {
-		float cv = inputs[MIN_INPUT].getVoltage();
-		float atten = params[MIN_ATTENUVERTER].getValue();
-		min += cv * atten;
-	}
-	return clamp(min, VOLTAGE_MIN, VOLTAGE_MAX);
-}
-
-float Lure::getModulatedMax() {
-	float max = params[MAX_PARAM].getValue();
-	if (inputs[MAX_INPUT].isConnected()) {
-		float cv = inputs[MAX_INPUT].getVoltage();
-		float atten = params[MAX_ATTENUVERTER].getValue();
-		max += cv * atten;
-	}
-	return clamp(max, VOLTAGE_MIN, VOLTAGE_MAX);
-}
-
-float Lure::getBias(float lower, float upper) {
-	float biasParam = params[BIAS_PARAM].getValue();
-	if (inputs[BIAS_INPUT].isConnected()) {
-		float cv = inputs[BIAS_INPUT].getVoltage();
-		float atten = params[BIAS_ATTENUVERTER].getValue();
-		biasParam += (cv / 10.f) * atten;
-	}
-	biasParam = clamp(biasParam, 0.f, 1.f);
-	return lower + biasParam * (upper - lower);
-}
-
-float Lure::getPullStrength() {
-	float rawPull = params[PULL_PARAM].getValue();
-	if (inputs[PULL_INPUT].isConnected()) {
-		float cv = inputs[PULL_INPUT].getVoltage();
-		float atten = params[PULL_ATTENUVERTER].getValue();
-		rawPull += (cv / 10.f) * atten;
-	}
-	rawPull = clamp(rawPull, 0.f, 1.f);
-	return powf(rawPull, PULL_EXPONENT);
-}
-
-int Lure::getStepInterval(float speedParam, float sampleRate) {
-	// Clamp knob position safely between 0.0 and 1.0
-	speedParam = clamp(speedParam, 0.f, 1.f);
-
-	// Logarithmic mapping for perceptual linearity at fast end
-	constexpr float SPEED_INTERVAL_MIN_MS = 1.0f;
-	constexpr float SPEED_INTERVAL_MAX_MS = 1000.0f;
-
-	float minLog = log10(SPEED_INTERVAL_MIN_MS);
-	float maxLog = log10(SPEED_INTERVAL_MAX_MS);
-	float logRange = maxLog - minLog;
-
-	// Invert the curve so higher knob = faster
-	float logValue = maxLog - speedParam * logRange;
-	float msInterval = powf(10.f, logValue);
-
-	// Convert ms → samples based on current sample rate
-	int samples = static_cast<int>(roundf((msInterval / 1000.f) * sampleRate));
-	return std::max(1, samples);  // Ensure we never return 0
-}
-
-
-float Lure::calculateForce(float bias, float lower, float upper, float pullParam) {
-	float relative = 0.f;
-	if (brownianValue < bias) {
-		float denom = bias - lower;
-		relative = (denom > 0.f) ? (bias - brownianValue) / denom : 0.f;
-	} else {
-		float denom = upper - bias;
-		relative = (denom > 0.f) ? (brownianValue - bias) / denom : 0.f;
-	}
-
-	relative = clamp(relative, 0.f, 1.f);
-	float gravity = pullParam * powf(relative, GRAVITY_EXPONENT);
-	float F_center = (brownianValue < bias) ? +gravity : -gravity;
-
-	// Edge repulsion
-	float distFromMin = brownianValue - lower + EPSILON;
-	float distFromMax = upper - brownianValue + EPSILON;
-	float F_edge = EDGE_REPEL_FACTOR * (
-		1.f / powf(distFromMin, EDGE_EXPONENT) -
-		1.f / powf(distFromMax, EDGE_EXPONENT)
-	);
-
-	return F_center + F_edge;
-}
-
-
-void Lure::process(const ProcessArgs& args) {
-	// Get fully modulated and clamped range
-	float min = getModulatedMin();
-	float max = getModulatedMax();
-
-	float lower = fmin(min, max);
-	float upper = fmax(min, max);
-	float rangeSafe = fmaxf(upper - lower, EPSILON);
-
-	// Compute speed modulation (handled inline since it's only used here)
-	float speedParam = params[SPEED_PARAM].getValue();
-
-	if (inputs[SPEED_INPUT].isConnected()) {
-		float cv = inputs[SPEED_INPUT].getVoltage();     // Expecting 0–10V
-		float atten = params[SPEED_ATTENUVERTER].getValue();  // -1 to +1
-		speedParam += (cv / 10.f) * atten;
-	}
-	
-	speedParam = clamp(speedParam, 0.f, 1.f);
-
-	// Only update periodically, based on current interval
-	if (++stepCounter >= currentStepInterval) {
-		stepCounter = 0;
-
-		// Recompute interval at step edge
-		currentStepInterval = getStepInterval(speedParam, args.sampleRate);
-
-		// Get bias and pull
-		float bias = getBias(lower, upper);
-		float pullParam = getPullStrength();
-
-		// Calculate total force toward center and edge repel
-		float F_net = calculateForce(bias, lower, upper, pullParam);
-
-		// Direction probability
-		float directionProb = 0.5f + 0.5f * clamp(F_net, -1.f, 1.f);
-		float direction = (random::uniform() < directionProb) ? 1.f : -1.f;
-
-		// Update value
-		brownianValue += direction * STEP_SIZE;
-		brownianValue = clamp(brownianValue, lower, upper);
-	}
-
-	// Output voltage
-	outputs[CV_OUTPUT].setVoltage(brownianValue);
-}
+#include "Lure.hpp"
+#include "rack.hpp"
+#ifndef TERROIR_HEADLESS
+#include "componentlibrary.hpp"
+#include "widgets/Magpie125.hpp"
+#include "widgets/Song60.hpp"
+#endif
+
+
+// ----------------------------------------------
+// Tunable constants for behavior shaping
+// ----------------------------------------------
+constexpr float VOLTAGE_MIN = -5.f;
+constexpr float VOLTAGE_MAX = 10.f;
+
+constexpr float ATTENUVERTER_RANGE = 1.f;
+constexpr float KNOB_BIAS_DEFAULT = 0.5f;
+constexpr float KNOB_PULL_DEFAULT = 0.5f;
+constexpr float KNOB_SPEED_DEFAULT = 0.5f;
+
+constexpr float STEP_SIZE = 0.05f;             // Fixed movement per step
+static_assert((VOLTAGE_MAX - VOLTAGE_MIN) / STEP_SIZE < LATTICE_STATES, "Lattice tables too small for the voltage range");
+
+constexpr float SPEED_EXPONENT = 1.f;          // Speed curve shape
+constexpr float SPEED_INTERVAL_MIN_MS = 0.1f;     // or lower if needed
+constexpr float SPEED_INTERVAL_MAX_MS = 1000.f;
+
+constexpr float PULL_EXPONENT = 2.0f;          // Perceptual pull shaping
+
+constexpr float LED_RANGE_NORM = 10.f;         // Range scale for LED normalization
+
+using namespace rack;
+using namespace rack::app;
+using simd::float_4;
+
+Lure::Lure() {
+    config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, 0);
+    
+    configParam(MIN_PARAM, -5.f, 10.f, 0.f, "Minimum output voltage");
+    configParam(MAX_PARAM, -5.f, 10.f, 10.f, "Maximum output voltage");
+    configParam(BIAS_PARAM, 0.f, 1.f, 0.5f, "Bias\nDrift center between Min and Max");
+    configParam(PULL_PARAM, 0.f, 1.f, 0.5f, "Pull\nGravity toward center\n0 = free walk, 1 = strongly centered");
+    configParam(SPEED_PARAM, 0.f, 1.f, 0.5f, "Speed\nDrift speed\n0 = slow, 1 = fast");
+    
+    configParam(MIN_ATTENUVERTER, -1.f, 1.f, 0.f, "Min Attenuverter");
+    configParam(MAX_ATTENUVERTER, -1.f, 1.f, 0.f, "Max Attenuverter");
+    configParam(BIAS_ATTENUVERTER, -1.f, 1.f, 0.f, "Bias Attenuverter");
+    configParam(PULL_ATTENUVERTER, -1.f, 1.f, 0.f, "Pull Attenuverter");
+    configParam(SPEED_ATTENUVERTER, -1.f, 1.f, 0.f, "Speed Attenuverter");
+
+    std::vector<std::string> voiceLabels = {"Auto (follow CV inputs)"};
+    for (int i = 1; i <= 16; ++i)
+        voiceLabels.push_back(std::to_string(i));
+    configSwitch(VOICES_PARAM, 0.f, 16.f, 0.f, "Voices", voiceLabels);
+
+    seed = random::u64();
+    restartWalk();
+}
+
+void Lure::restartWalk() {
+	for (int g = 0; g < 4; ++g) {
+		brownianValue[g] = 0.f;
+		anchorWalk(g, float_4::mask());
+		stepCounter[g] = 0.f;
+		currentStepInterval[g] = 1000.f;
+		walkRandom[g].seed(seed, 4 * g);
+	}
+	controlRate.invalidate();
+}
+
+// Puts the walkers in `lanes` on the lattice through their current value,
+// which a clamp to the range may have moved off their old one
+void Lure::anchorWalk(int g, const float_4& lanes) {
+	int mask = simd::movemask(lanes);
+	for (int i = 0; i < 4; ++i) {
+		if (!(mask & (1 << i))) continue;
+		float value = brownianValue[g][i];
+		float origin = VOLTAGE_MIN + std::fmod(value - VOLTAGE_MIN, STEP_SIZE);
+		latticeOrigin[g][i] = origin;
+		latticeState[g][i] = std::round((value - origin) / STEP_SIZE);
+		if (lattice[4 * g + i].setOrigin(origin, STEP_SIZE)) shareLattice(4 * g + i);
+	}
+}
+
+// Points `walker` at walker 0's table if their keys match. A new key for
+// walker 0 moves everyone.
+void Lure::shareLattice(int walker) {
+	if (walker == 0) {
+		for (int i = 0; i < 16; ++i) latticeShare[i] = lattice[i].hasSameKey(lattice[0]) ? 0 : i;
+	}
+	else {
+		latticeShare[walker] = lattice[walker].hasSameKey(lattice[0]) ? 0 : walker;
+	}
+}
+
+// The rows are kept once allocated, since the audio thread may still be
+// drawing from them
+void Lure::setAudioRate(bool enabled) {
+	if (enabled && !latticeRows) {
+		latticeRows.reset(new LatticeRows[16]);
+		for (int i = 0; i < 16; ++i) lattice[i].setRows(&latticeRows[i]);
+		latticeRowsReady.store(true, std::memory_order_release);
+	}
+	audioRate = enabled;
+}
+
+void Lure::onReset() {
+	restartWalk();
+}
+
+json_t* Lure::dataToJson() {
+	json_t* rootJ = json_object();
+	json_object_set_new(rootJ, "seed", json_integer((json_int_t)seed));
+	json_object_set_new(rootJ, "audioRate", json_boolean(audioRate.load()));
+	json_object_set_new(rootJ, "coupling", json_integer(couplingMode.load()));
+	controlRate.dataToJson(rootJ);
+	return rootJ;
+}
+
+void Lure::dataFromJson(json_t* rootJ) {
+	json_t* seedJ = json_object_get(rootJ, "seed");
+	if (seedJ) {
+		seed = (uint64_t)json_integer_value(seedJ);
+		restartWalk();
+	}
+	json_t* audioRateJ = json_object_get(rootJ, "audioRate");
+	setAudioRate(audioRateJ && json_is_true(audioRateJ));
+	json_t* couplingJ = json_object_get(rootJ, "coupling");
+	couplingMode = couplingJ ? clamp((int)json_integer_value(couplingJ), 0, LURE_COUPLING_MODES - 1) : 0;
+	controlRate.dataFromJson(rootJ);
+}
+
+#ifndef TERROIR_HEADLESS
+LureWidget::LureWidget(Lure* module) {
+    setModule(module);
+    setPanel(createPanel(asset::plugin(pluginInstance, "res/Lure.svg")));
+
+		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 20)), module, Lure::MIN_PARAM));
+        addParam(createParamCentered<Song60>(mm2px(Vec(23, 22.25)), module, Lure::MIN_ATTENUVERTER));
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 22.33)), module, Lure::MIN_INPUT));
+
+		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 39)), module, Lure::MAX_PARAM));
+        addParam(createParamCentered<Song60>(mm2px(Vec(23, 41.25)), module, Lure::MAX_ATTENUVERTER));
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 41.33)), module, Lure::MAX_INPUT));    
+
+		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 58)), module, Lure::BIAS_PARAM));
+        addParam(createParamCentered<Song60>(mm2px(Vec(23, 60.25)), module, Lure::BIAS_ATTENUVERTER));
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 60.33)), module, Lure::BIAS_INPUT));
+        
+		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 77)), module, Lure::PULL_PARAM));
+        addParam(createParamCentered<Song60>(mm2px(Vec(23, 79.25)), module, Lure::PULL_ATTENUVERTER));
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 79.33)), module, Lure::PULL_INPUT));
+
+		addParam(createParamCentered<Magpie125>(window::mm2px(math::Vec(9, 96)), module, Lure::SPEED_PARAM));
+        addParam(createParamCentered<Song60>(mm2px(Vec(23, 98.25)), module, Lure::SPEED_ATTENUVERTER));
+        addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34, 98.33)), module, Lure::SPEED_INPUT));
+
+        addParam(createParamCentered<Song60>(mm2px(Vec(9, 110)), module, Lure::VOICES_PARAM));
+        addOutput(createOutputCentered<componentlibrary::PJ301MPort>(mm2px(math::Vec(20.32,110)), module, Lure::CV_OUTPUT));
+
+		addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
+		addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
+		addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+		addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+}
+
+void LureWidget::appendContextMenu(Menu* menu) {
+	Lure* module = getModule<Lure>();
+	if (!module) return;
+
+	menu->addChild(new MenuSeparator);
+	menu->addChild(createBoolMenuItem("Audio-rate speed range", "",
+		[=]() { return module->audioRate.load(); },
+		[=](bool audioRate) { module->setAudioRate(audioRate); }
+	));
+	menu->addChild(createIndexSubmenuItem("Walkers",
+		{"Independent", "Coupled", "Coupled, attracting", "Coupled, strongly attracting", "Coupled, repelling", "Coupled, strongly repelling"},
+		[=]() { return (size_t)module->couplingMode.load(); },
+		[=](size_t index) { module->couplingMode = (int)index; }
+	));
+	appendControlRateMenu(menu, &module->controlRate);
+}
+#endif
+
+int Lure::getChannelCount() {
+	// Voices knob: 0 = follow the widest CV input, 1-16 = fixed voice count
+	int voices = static_cast<int>(params[VOICES_PARAM].getValue());
+	if (voices > 0)
+		return clamp(voices, 1, 16);
+
+	int count = 1;
+	for (int i = 0; i < NUM_INPUTS; ++i)
+		count = std::max(count, inputs[i].getChannels());
+	return count;
+}
+
+float_4 Lure::getModulatedMin(int c) {
+	float_4 min = params[MIN_PARAM].getValue();
+	if (inputs[MIN_INPUT].isConnected()) {
+		float_4 cv = inputs[MIN_INPUT].getPolyVoltageSimd<float_4>(c);
+		float atten = params[MIN_ATTENUVERTER].getValue();
+		min += cv * atten;
+	}
+	return simd::clamp(min, VOLTAGE_MIN, VOLTAGE_MAX);
+}
+
+float_4 Lure::getModulatedMax(int c) {
+	float_4 max = params[MAX_PARAM].getValue();
+	if (inputs[MAX_INPUT].isConnected()) {
+		float_4 cv = inputs[MAX_INPUT].getPolyVoltageSimd<float_4>(c);
+		float atten = params[MAX_ATTENUVERTER].getValue();
+		max += cv * atten;
+	}
+	return simd::clamp(max, VOLTAGE_MIN, VOLTAGE_MAX);
+}
+
+float_4 Lure::getBias(int c, float_4 lower, float_4 upper) {
+	float_4 biasParam = params[BIAS_PARAM].getValue();
+	if (inputs[BIAS_INPUT].isConnected()) {
+		float_4 cv = inputs[BIAS_INPUT].getPolyVoltageSimd<float_4>(c);
+		float atten = params[BIAS_ATTENUVERTER].getValue();
+		biasParam += (cv / 10.f) * atten;
+	}
+	biasParam = simd::clamp(biasParam, 0.f, 1.f);
+	return lower + biasParam * (upper - lower);
+}
+
+float_4 Lure::getPullStrength(int c) {
+	float_4 rawPull = params[PULL_PARAM].getValue();
+	if (inputs[PULL_INPUT].isConnected()) {
+		float_4 cv = inputs[PULL_INPUT].getPolyVoltageSimd<float_4>(c);
+		float atten = params[PULL_ATTENUVERTER].getValue();
+		rawPull += (cv / 10.f) * atten;
+	}
+	rawPull = simd::clamp(rawPull, 0.f, 1.f);
+	// simd::pow is exp(log(x)), so keep zero out of the log
+	return simd::ifelse(rawPull > 0.f, simd::pow(rawPull, float_4(PULL_EXPONENT)), 0.f);
+}
+
+float_4 Lure::getSpeed(int c) {
+	float_4 speedParam = params[SPEED_PARAM].getValue();
+	if (inputs[SPEED_INPUT].isConnected()) {
+		float_4 cv = inputs[SPEED_INPUT].getPolyVoltageSimd<float_4>(c);     // Expecting 0–10V
+		float atten = params[SPEED_ATTENUVERTER].getValue();  // -1 to +1
+		speedParam += (cv / 10.f) * atten;
+	}
+	return simd::clamp(speedParam, 0.f, 1.f);
+}
+
+float_4 Lure::getStepInterval(float_4 speedParam, float sampleRate, float_4& jump) {
+	// Clamp knob position safely between 0.0 and 1.0
+	speedParam = simd::clamp(speedParam, 0.f, 1.f);
+
+	// Logarithmic mapping for perceptual linearity at fast end
+	constexpr float SPEED_INTERVAL_MIN_MS = 1.0f;
+	constexpr float SPEED_INTERVAL_MAX_MS = 1000.0f;
+	constexpr float AUDIO_RATE_INTERVAL_MIN_MS = 0.001f;
+	bool audio = audioRate;
+
+	float minLog = log10(audio ? AUDIO_RATE_INTERVAL_MIN_MS : SPEED_INTERVAL_MIN_MS);
+	float maxLog = log10(SPEED_INTERVAL_MAX_MS);
+	float logRange = maxLog - minLog;
+
+	// Invert the curve so higher knob = faster
+	float_4 logValue = maxLog - speedParam * logRange;
+	float_4 msInterval = simd::pow(10.f, logValue);
+
+	// Convert ms → samples based on current sample rate
+	float_4 samples = (msInterval / 1000.f) * sampleRate;
+
+	// Faster than a step per sample: step every sample, several steps at a time
+	jump = audio ? simd::clamp(simd::floor(1.f / samples + 0.5f), 1.f, (float)LATTICE_MAX_JUMP) : 1.f;
+
+	samples = simd::floor(samples + 0.5f);
+	return simd::fmax(1.f, samples);  // Ensure we never return 0
+}
+
+
+// Maps params and CV for the four walkers from channel c into their field.
+// Coupled walkers all take walker 0's, which is mapped once for them.
+void Lure::updateField(int c, float sampleRate) {
+	WalkField& f = field[c / 4];
+	if (coupled && c > 0) {
+		if (field[0].stale) updateField(0, sampleRate);
+		f = field[0];
+	}
+	else {
+		// Get fully modulated and clamped range
+		float_4 min = getModulatedMin(c);
+		float_4 max = getModulatedMax(c);
+		f.lower = simd::fmin(min, max);
+		f.upper = simd::fmax(min, max);
+
+		f.bias = getBias(c, f.lower, f.upper);
+		f.pull = getPullStrength(c);
+		f.interval = getStepInterval(getSpeed(c), sampleRate, f.jump);
+		if (coupled) {
+			// Channel 0 of each CV for every walker
+			f.lower = f.lower[0];
+			f.upper = f.upper[0];
+			f.bias = f.bias[0];
+			f.pull = f.pull[0];
+			f.interval = f.interval[0];
+			f.jump = f.jump[0];
+		}
+	}
+	f.stale = false;
+
+	for (int i = 0; i < 4; ++i) {
+		if (lattice[c + i].setField(f.lower[i], f.upper[i], f.bias[i], f.pull[i])) shareLattice(c + i);
+	}
+}
+
+void Lure::process(const ProcessArgs& args) {
+	TERROIR_PROFILE_START(profiler);
+	if (controlRate.tick()) {
+		channels = getChannelCount();
+		int mode = couplingMode.load(std::memory_order_relaxed);
+		coupled = mode > 0;
+		couplingForce = (channels > 1) ? LURE_COUPLING_FORCE[mode] : 0.f;
+		for (int g = 0; g < 4; ++g) field[g].stale = true;
+	}
+	TERROIR_PROFILE_LAP(profiler, MAPPING_STAGE);
+	// Nobody reads an unpatched walk; it holds its value until it is patched again
+	if (!outputs[CV_OUTPUT].isConnected()) {
+		TERROIR_PROFILE_END(profiler, args.sampleTime, reportProfile());
+		return;
+	}
+
+	float walkerSum = 0.f; // Taken before the first step of the sample, when coupled
+	bool summed = false;
+	for (int c = 0; c < channels; c += 4) {
+		int g = c / 4;
+
+		// Only update periodically, based on each walker's own interval
+		stepCounter[g] += 1.f;
+		float_4 stepping = stepCounter[g] >= currentStepInterval[g];
+		if (simd::movemask(stepping) != 0) {
+			if (field[g].stale) {
+				TERROIR_PROFILE_LAP(profiler, FORCE_STAGE);
+				updateField(c, args.sampleRate);
+				TERROIR_PROFILE_LAP(profiler, MAPPING_STAGE);
+			}
+			const WalkField& f = field[g];
+
+			// At audio rate a walker takes several steps per step time: all at
+			// once from its lattice table where it can, otherwise one by one
+			float_4 single = stepping;
+			float_4 jumping = stepping & (f.jump > 1.f);
+			float_4 others = 0.f;
+			if (couplingForce != 0.f) {
+				// Each step hangs on where the other walkers are, so
+				// none can be taken from the lattice tables
+				jumping = 0.f;
+				if (!summed) walkerSum = sumWalkers();
+				summed = true;
+				// These walkers haven't stepped since the sum was taken
+				others = (walkerSum - brownianValue[g]) / (float)(channels - 1);
+			}
+			if (simd::movemask(jumping) != 0 && latticeRowsReady.load(std::memory_order_acquire))
+				single = single & ~takeJumps(g, jumping);
+			for (float n = 1.f; simd::movemask(single) != 0; n += 1.f) {
+				takeStep(g, single, others);
+				single = single & (f.jump > n);
+			}
+
+			currentStepInterval[g] = simd::ifelse(stepping, f.interval, currentStepInterval[g]);
+			stepCounter[g] = simd::ifelse(stepping, 0.f, stepCounter[g]);
+		}
+
+		// Output voltage
+		outputs[CV_OUTPUT].setVoltageSimd(brownianValue[g], c);
+	}
+	outputs[CV_OUTPUT].setChannels(channels);
+	TERROIR_PROFILE_LAP(profiler, FORCE_STAGE);
+	TERROIR_PROFILE_END(profiler, args.sampleTime, reportProfile());
+}
+
+// One step for the walkers in `stepping`. `others` is each walker's mean of
+// the other walkers' values at the start of the sample, only read when a
+// coupling force is on.
+void Lure::takeStep(int g, const float_4& stepping, const float_4& others) {
+	const WalkField& f = field[g];
+	int lanes = simd::movemask(stepping);
+
+	// Up probabilities from the walkers' lattice tables; the force is only
+	// computed when one of them hasn't met its state under this field yet.
+	// A coupling force depends on more than the state, so it isn't cached.
+	float_4 upProb = 0.f;
+	bool cached = couplingForce == 0.f;
+	for (int i = 0; i < 4 && cached; ++i) {
+		if ((lanes & (1 << i)) && !getLattice(4 * g + i).getUp((int)latticeState[g][i], upProb[i]))
+			cached = false;
+	}
+	if (!cached) {
+		// Calculate total force toward center and edge repel
+		float_4 F_net;
+		DspKernels::get().walkForce(latticeOrigin[g] + latticeState[g] * STEP_SIZE, f.bias, f.lower, f.upper, f.pull, F_net);
+		if (couplingForce != 0.f) {
+			// Toward (or away from) the mean of the other walkers
+			F_net += couplingForce * (others - brownianValue[g]) / simd::fmax(f.upper - f.lower, STEP_SIZE);
+			upProb = walkUpProbability(F_net);
+		}
+		else {
+			upProb = walkUpProbability(F_net);
+			for (int i = 0; i < 4; ++i) {
+				if (lanes & (1 << i)) getLattice(4 * g + i).setUp((int)latticeState[g][i], upProb[i]);
+			}
+		}
+	}
+
+	// Only stepping walkers consume a draw
+	float_4 draw = walkRandom[g].uniform(stepping);
+	float_4 direction = simd::ifelse(draw < upProb, 1.f, -1.f);
+
+	// Update value. A step out of the range is clamped to its edge, which
+	// usually lies off the walker's lattice.
+	float_4 state = latticeState[g] + direction;
+	float_4 value = latticeOrigin[g] + state * STEP_SIZE;
+	float_4 clamped = stepping & ((value < f.lower) | (value > f.upper));
+	latticeState[g] = simd::ifelse(stepping, state, latticeState[g]);
+	brownianValue[g] = simd::ifelse(stepping, simd::clamp(value, f.lower, f.upper), brownianValue[g]);
+	if (simd::movemask(clamped) != 0) anchorWalk(g, clamped);
+}
+
+// Sum of the values of the walkers in use
+float Lure::sumWalkers() {
+	float_4 sum = 0.f;
+	for (int c = 0; c < channels; c += 4)
+		sum += simd::ifelse(float_4(0.f, 1.f, 2.f, 3.f) + (float)c < (float)channels, brownianValue[c / 4], 0.f);
+	return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+// Takes the whole jump of each walker in `jumping` with one draw from its
+// lattice table. Returns the lanes that jumped; the rest were near enough
+// an edge to need their steps one at a time.
+float_4 Lure::takeJumps(int g, const float_4& jumping) {
+	int lanes = simd::movemask(jumping);
+	float_4 draw = walkRandom[g].uniform(jumping);
+	float_4 jumped = 0.f;
+	for (int i = 0; i < 4; ++i) {
+		if (!(lanes & (1 << i))) continue;
+		int steps = (int)field[g].jump[i];
+		// A walker whose jump length would push another out of the table it
+		// shares keeps its rows in its own
+		LatticeTable* table = &getLattice(4 * g + i);
+		if (!table->hasRowsFor(steps)) table = &lattice[4 * g + i];
+		int target;
+		if (table->jump((int)latticeState[g][i], steps, draw[i], target)) {
+			latticeState[g][i] = (float)target;
+			jumped[i] = 1.f;
+		}
+	}
+	jumped = jumped > 0.f;
+	brownianValue[g] = simd::ifelse(jumped, latticeOrigin[g] + latticeState[g] * STEP_SIZE, brownianValue[g]);
+	return jumped;
+}
+
+#ifdef TERROIR_PROFILE
+void Lure::reportProfile() {
+	size_t bytes = sizeof(Lure);
+	if (latticeRowsReady.load(std::memory_order_acquire)) bytes += 16 * sizeof(LatticeRows);
+	profiler.report(id, bytes, 0);
+}
+#endif
@@ -1,56 +1,149 @@
-#pragma once
-
-#include <rack.hpp>
-
-extern rack::Plugin* pluginInstance;
-
-struct Lure : rack::Module {
-
-	float brownianValue = 0.f;
-	int stepCounter = 0;
-	int currentStepInterval = 1000; // default = ~22ms @ 44.1kHz
-
-	enum ParamIds {
-		MIN_PARAM,
-		MAX_PARAM,
-		BIAS_PARAM,
-		PULL_PARAM,
-		SPEED_PARAM,
-		MIN_ATTENUVERTER,
-		MAX_ATTENUVERTER,
-		BIAS_ATTENUVERTER,
-		PULL_ATTENUVERTER,
-		SPEED_ATTENUVERTER,
-		NUM_PARAMS
-	};
-
-	enum InputIds {
-		MIN_INPUT,
-		MAX_INPUT,
-		BIAS_INPUT,
-		PULL_INPUT,
-		SPEED_INPUT,
-		NUM_INPUTS
-	};
-
-	enum OutputIds {
-		CV_OUTPUT,
-		NUM_OUTPUTS
-	};
-
-	Lure();
-
-	void process(const ProcessArgs& args) override;
-
-private:
-	float getModulatedMin();
-	float getModulatedMax();
-	float getBias(float lower, float upper);
-	float getPullStrength();
-	int getStepInterval(float speedParam, float sampleRate);
-	float calculateForce(float bias, float lower, float upper, float pullParam);
-};
-
-struct LureWidget : rack::ModuleWidget {
-	LureWidget(Lure* module);
-};
+#pragma once
+
+#include <rack.hpp>
+#include "dsp/Random.hpp"
+#include "dsp/Kernels.hpp"
+#include "dsp/Lattice.hpp"
+#include "ControlRate.hpp"
+#include "Profiler.hpp"
+#include <atomic>
+#include <memory>
+
+extern rack::Plugin* pluginInstance;
+
+// Coupling menu, in order: independent walkers, then coupled ones with no
+// force between them, attracting, strongly attracting, repelling and
+// strongly repelling. The force on a coupled walker is this times its
+// distance to the other walkers' mean, as a fraction of the range.
+static const int LURE_COUPLING_MODES = 6;
+static const float LURE_COUPLING_FORCE[LURE_COUPLING_MODES] = {0.f, 0.f, 0.25f, 1.f, -0.25f, -1.f};
+
+struct Lure : rack::Module {
+
+	// One walker per polyphony channel, packed four to a float_4
+	rack::simd::float_4 brownianValue[4] = {};
+	rack::simd::float_4 stepCounter[4] = {};
+	rack::simd::float_4 currentStepInterval[4] = {1000.f, 1000.f, 1000.f, 1000.f}; // default = ~22ms @ 44.1kHz
+	int channels = 1;
+
+	// Each walker's position on its lattice (value = origin + state * STEP_SIZE)
+	// and the cached transition probabilities for it. Every walker keys its
+	// own table, but reads walker 0's while their keys match, so walkers
+	// sharing a field (no poly CV) fill one table between them.
+	rack::simd::float_4 latticeOrigin[4] = {};
+	rack::simd::float_4 latticeState[4] = {};
+	LatticeTable lattice[16];
+	int latticeShare[16] = {}; // Table each walker reads
+
+	// Lets SPEED reach down to 1 µs steps, up to LATTICE_MAX_JUMP per sample;
+	// set through setAudioRate() by the UI thread
+	std::atomic<bool> audioRate{false};
+
+	// Jump rows for the lattice tables, one LatticeRows each. They only
+	// matter at audio rate and take about 180 KB a table, so they are
+	// allocated the first time audio rate is turned on and published by
+	// latticeRowsReady; until then every walker steps one at a time.
+	std::unique_ptr<LatticeRows[]> latticeRows;
+	std::atomic<bool> latticeRowsReady{false};
+
+	// Coupled walkers (menu option, saved with the patch) all walk one
+	// field, mapped once per control block from channel 0 of each CV, so
+	// they also share a step interval. Any force between them is figured
+	// from where they all were at the start of the sample. Index into
+	// LURE_COUPLING_FORCE; written by the UI thread.
+	std::atomic<int> couplingMode{0};
+	bool coupled = false; // couplingMode as of the last control block
+	float couplingForce = 0.f;
+
+	// Walk field per four walkers, mapped from params and CV at most once per
+	// control block: a new block only marks it stale, and the next step that
+	// needs it remaps it, so slow walks skip most blocks entirely
+	struct WalkField {
+		rack::simd::float_4 lower = 0.f;
+		rack::simd::float_4 upper = 10.f;
+		rack::simd::float_4 bias = 5.f;
+		rack::simd::float_4 pull = 0.f;
+		rack::simd::float_4 interval = 1000.f; // Samples between steps
+		rack::simd::float_4 jump = 1.f;        // Steps per step time; above 1 only at audio rate
+		bool stale = true;
+	};
+	WalkField field[4];
+	ControlRate controlRate;
+
+	// Each walker draws from its own stream of the instance seed, so a walk
+	// replays identically after the patch is reloaded
+	uint64_t seed = 0;
+	LaneRandom walkRandom[4];
+
+	enum ParamIds {
+		MIN_PARAM,
+		MAX_PARAM,
+		BIAS_PARAM,
+		PULL_PARAM,
+		SPEED_PARAM,
+		MIN_ATTENUVERTER,
+		MAX_ATTENUVERTER,
+		BIAS_ATTENUVERTER,
+		PULL_ATTENUVERTER,
+		SPEED_ATTENUVERTER,
+		VOICES_PARAM,
+		NUM_PARAMS
+	};
+
+	enum InputIds {
+		MIN_INPUT,
+		MAX_INPUT,
+		BIAS_INPUT,
+		PULL_INPUT,
+		SPEED_INPUT,
+		NUM_INPUTS
+	};
+
+	enum OutputIds {
+		CV_OUTPUT,
+		NUM_OUTPUTS
+	};
+
+	// process() stages timed in TERROIR_PROFILE builds
+	enum ProfileStages {
+		MAPPING_STAGE,
+		FORCE_STAGE,
+		NUM_STAGES
+	};
+#ifdef TERROIR_PROFILE
+	StageProfiler profiler{"Lure", {"mapping", "force"}};
+	void reportProfile();
+#endif
+
+	Lure();
+
+	void setAudioRate(bool enabled); // UI thread
+	void process(const ProcessArgs& args) override;
+	void onReset() override;
+	json_t* dataToJson() override;
+	void dataFromJson(json_t* rootJ) override;
+
+private:
+	void restartWalk();
+	void anchorWalk(int g, const rack::simd::float_4& lanes);
+	void shareLattice(int walker);
+	LatticeTable& getLattice(int walker) { return lattice[latticeShare[walker]]; }
+	void takeStep(int g, const rack::simd::float_4& stepping, const rack::simd::float_4& others);
+	float sumWalkers();
+	rack::simd::float_4 takeJumps(int g, const rack::simd::float_4& jumping);
+	void updateField(int c, float sampleRate);
+	int getChannelCount();
+	rack::simd::float_4 getModulatedMin(int c);
+	rack::simd::float_4 getModulatedMax(int c);
+	rack::simd::float_4 getBias(int c, rack::simd::float_4 lower, rack::simd::float_4 upper);
+	rack::simd::float_4 getPullStrength(int c);
+	rack::simd::float_4 getSpeed(int c);
+	rack::simd::float_4 getStepInterval(rack::simd::float_4 speedParam, float sampleRate, rack::simd::float_4& jump);
+};
+
+#ifndef TERROIR_HEADLESS
+struct LureWidget : rack::ModuleWidget {
+	LureWidget(Lure* module);
+	void appendContextMenu(rack::ui::Menu* menu) override;
+};
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapping stays valid until
+// close() or destruction; the OS pages it in on demand and shares the pages
+// between every process mapping the same file.
+struct MappedFile {
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return ptr != nullptr; }
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* ptr = nullptr;
+    size_t length = 0;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+// --- Hot-path Profiling ---
+// Built only with TERROIR_PROFILE defined (make PROFILE=1); otherwise the
+// macros below expand to nothing and release builds carry no trace of it.
+//
+// Each module's process() is split into a few named stages. process() calls
+// TERROIR_PROFILE_START on entry and TERROIR_PROFILE_LAP after each stage,
+// which charges the cycles since the previous mark to that stage. Only one
+// sample in PROFILE_SAMPLE_INTERVAL is timed, so the timestamp reads (tens
+// of cycles each, more under virtualization) stay out of the figures they
+// measure; the rest cost a predictable branch per mark. Every
+// PROFILE_REPORT_SECONDS of engine time TERROIR_PROFILE_END runs the
+// module's report callback, which logs average cycles per sample for each
+// stage together with the instance's resident memory, then starts a new
+// period. Logging happens on the audio thread, which is acceptable for a
+// diagnostic build but not for a release one.
+
+#ifdef TERROIR_PROFILE
+
+#include <rack.hpp>
+#include <cstdint>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+static const int PROFILE_MAX_STAGES = 4;
+static const int PROFILE_SAMPLE_INTERVAL = 16; // Power of two
+static const float PROFILE_REPORT_SECONDS = 10.f;
+
+// TSC cycles on x86; nanoseconds elsewhere, which the report labels as ticks
+inline uint64_t readProfileCounter() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct StageProfiler {
+    const char* moduleName;
+    const char* stageNames[PROFILE_MAX_STAGES];
+    int stageCount;
+    uint64_t stageCycles[PROFILE_MAX_STAGES] = {};
+    uint64_t mark = 0;
+    bool timing = false; // This sample is one of the timed ones
+    uint32_t sampleIndex = 0;
+    int64_t samples = 0; // Timed samples in this period
+    float elapsed = 0.f; // Seconds of engine time in this period
+
+    StageProfiler(const char* moduleName, std::initializer_list<const char*> names)
+        : moduleName(moduleName), stageCount(0) {
+        for (const char* name : names)
+            if (stageCount < PROFILE_MAX_STAGES) stageNames[stageCount++] = name;
+    }
+
+    void start() {
+        timing = (++sampleIndex & (PROFILE_SAMPLE_INTERVAL - 1)) == 0;
+        if (timing) mark = readProfileCounter();
+    }
+
+    void lap(int stage) {
+        if (!timing) return;
+        uint64_t now = readProfileCounter();
+        stageCycles[stage] += now - mark;
+        mark = now;
+    }
+
+    // Counts one engine sample; true when a report is due
+    bool endSample(float sampleTime) {
+        if (timing) ++samples;
+        elapsed += sampleTime;
+        return elapsed >= PROFILE_REPORT_SECONDS;
+    }
+
+    // Logs the period and starts the next one. `sharedBytes` is memory this
+    // instance holds a reference to but may share with others (e.g. pooled samples).
+    void report(int64_t moduleId, size_t residentBytes, size_t sharedBytes) {
+        if (samples == 0) samples = 1;
+        uint64_t total = 0;
+        for (int s = 0; s < stageCount; ++s) total += stageCycles[s];
+        std::string stages;
+        for (int s = 0; s < stageCount; ++s) {
+            char field[96];
+            snprintf(field, sizeof(field), " %s=%.1f (%.0f%%)", stageNames[s],
+                (double)stageCycles[s] / samples, total ? 100.0 * stageCycles[s] / total : 0.0);
+            stages += field;
+        }
+        INFO("Terroir profile %s #%lld: %lld timed samples, ticks/sample total=%.1f%s, resident=%.1f KiB, shared=%.1f KiB",
+            moduleName, (long long)moduleId, (long long)samples, (double)total / samples, stages.c_str(),
+            residentBytes / 1024.0, sharedBytes / 1024.0);
+        for (int s = 0; s < stageCount; ++s) stageCycles[s] = 0;
+        samples = 0;
+        elapsed = 0.f;
+    }
+};
+
+#define TERROIR_PROFILE_START(profiler) (profiler).start()
+#define TERROIR_PROFILE_LAP(profiler, stage) (profiler).lap(stage)
+#define TERROIR_PROFILE_END(profiler, sampleTime, report) do { if ((profiler).endSample(sampleTime)) report; } while (0)
+
+#else
+
+#define TERROIR_PROFILE_START(profiler) ((void)0)
+#define TERROIR_PROFILE_LAP(profiler, stage) ((void)0)
+#define TERROIR_PROFILE_END(profiler, sampleTime, report) ((void)0)
+
+#endif
@@ -0,0 +1,341 @@
+#include "SamplePool.hpp"
+#include "dsp/Resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <sys/stat.h>
+
+// --- dr_wav ---
+#include "dr_wav.h"
+// --- end dr_wav ---
+
+
+// --- Decoded Sample Cache ---
+// <user>/Terroir/SampleCache/<stem>-<hash>[-<rate>].f32 (or .i16 for
+// SAMPLE_INT16) holds a header followed by
+// the packed mip levels (each mono level with its guard frames, see
+// getPackedSize()), 64-byte aligned so the mapped data can be read directly. The source file's size and modification time are stored in the
+// header; a mismatch means the WAV changed and the entry is rebuilt.
+static const char SAMPLE_CACHE_MAGIC[8] = {'T', 'R', 'R', 'S', 'M', 'P', 'L', '\0'};
+static const uint32_t SAMPLE_CACHE_VERSION = 3;
+static const uint32_t SAMPLE_CACHE_DATA_OFFSET = 64;
+
+struct SampleCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dataOffset;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t length; // Level 0 frames
+    float sampleRate;
+    uint32_t format; // SampleFormat
+    float compactScale;
+    uint32_t reserved;
+};
+
+static size_t getFrameBytes(SampleFormat format) {
+    return (format == SAMPLE_INT16) ? sizeof(int16_t) : sizeof(float);
+}
+
+// Level L holds length / 2^L frames (rounded, at least one)
+static size_t getLevelLength(size_t length, int level) {
+    size_t half = ((size_t)1 << level) / 2;
+    return std::max<size_t>((length + half) >> level, 1);
+}
+
+// Frames taken by all levels of a `length`-frame sample, guards included
+static size_t getPackedSize(size_t length) {
+    if (length == 0) return 0;
+    size_t size = 0;
+    for (int level = 0; level < SAMPLE_MIP_LEVELS; ++level)
+        size += getLevelLength(length, level) + 2 * SAMPLE_GUARD_FRAMES;
+    return size;
+}
+
+struct SourceInfo {
+    uint64_t size = 0;
+    int64_t modified = 0;
+};
+
+static bool getSourceInfo(const std::string& path, SourceInfo& info) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    info.size = (uint64_t)st.st_size;
+    info.modified = (int64_t)st.st_mtime;
+    return true;
+}
+
+static std::string getCachePath(const std::string& path, float sampleRate, SampleFormat format) {
+    // FNV-1a over the full source path keeps same-named files apart
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char ch : path) { hash ^= (uint8_t)ch; hash *= 0x100000001b3ULL; }
+    const char* extension = (format == SAMPLE_INT16) ? "i16" : "f32";
+    char name[48];
+    if (sampleRate > 0.f) snprintf(name, sizeof(name), "-%016llx-%d.%s", (unsigned long long)hash, (int)sampleRate, extension);
+    else snprintf(name, sizeof(name), "-%016llx.%s", (unsigned long long)hash, extension);
+    return rack::asset::user("Terroir/SampleCache/" + rack::system::getStem(path) + name);
+}
+
+static bool writeCache(const std::string& cachePath, const SourceInfo& info, const SampleData& data, const void* packed) {
+    rack::system::createDirectories(rack::system::getDirectory(cachePath));
+    SampleCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SAMPLE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = SAMPLE_CACHE_VERSION;
+    header.dataOffset = SAMPLE_CACHE_DATA_OFFSET;
+    header.sourceSize = info.size;
+    header.sourceModified = info.modified;
+    header.length = data.length;
+    header.sampleRate = data.nativeRate;
+    header.format = data.format;
+    header.compactScale = data.compactScale;
+    size_t frameBytes = getFrameBytes(data.format);
+    size_t packedSize = getPackedSize(data.length);
+
+    // Write beside the target and rename, so a reader never maps a partial file
+    std::string tmpPath = cachePath + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) return false;
+    char padding[SAMPLE_CACHE_DATA_OFFSET] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(padding, SAMPLE_CACHE_DATA_OFFSET - sizeof(header), 1, file) == 1
+        && std::fwrite(packed, frameBytes, packedSize, file) == packedSize;
+    ok = (std::fclose(file) == 0) && ok;
+    if (ok) {
+        std::remove(cachePath.c_str());
+        ok = std::rename(tmpPath.c_str(), cachePath.c_str()) == 0;
+    }
+    if (!ok) { std::remove(tmpPath.c_str()); WARN("Could not write sample cache %s", cachePath.c_str()); }
+    return ok;
+}
+
+// Maps a file written by writeCache, checking only that it is well formed
+static bool mapCacheFile(const std::string& cachePath, MappedFile& mapping, SampleCacheHeader& header) {
+    if (!mapping.open(cachePath)) return false;
+    if (mapping.size() < SAMPLE_CACHE_DATA_OFFSET) { mapping.close(); return false; }
+    memcpy(&header, mapping.data(), sizeof(header));
+    bool valid = memcmp(header.magic, SAMPLE_CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == SAMPLE_CACHE_VERSION
+        && header.dataOffset == SAMPLE_CACHE_DATA_OFFSET
+        && (header.format == SAMPLE_FLOAT32 || header.format == SAMPLE_INT16)
+        && mapping.size() == SAMPLE_CACHE_DATA_OFFSET + getPackedSize(header.length) * getFrameBytes((SampleFormat)header.format);
+    if (!valid) mapping.close();
+    return valid;
+}
+
+static bool mapCache(const std::string& cachePath, const SourceInfo& info, SampleFormat format, MappedFile& mapping, SampleCacheHeader& header) {
+    if (!mapCacheFile(cachePath, mapping, header)) return false;
+    bool current = header.sourceSize == info.size
+        && header.sourceModified == info.modified
+        && header.format == (uint32_t)format;
+    if (!current) mapping.close();
+    return current;
+}
+
+
+SamplePool& SamplePool::instance() {
+    static SamplePool pool;
+    return pool;
+}
+
+SampleHandle SamplePool::acquire(const std::string& path, float sampleRate, SampleFormat format) {
+    std::string key = path + "@" + std::to_string((int)sampleRate) + ((format == SAMPLE_INT16) ? "/i16" : "");
+    std::lock_guard<std::mutex> lock(mutex);
+    SampleHandle handle = entries[key].lock();
+    if (handle) return handle;
+
+    std::shared_ptr<SampleData> data = std::make_shared<SampleData>();
+    data->format = format;
+    entries[key] = data;
+    Job job;
+    job.path = path;
+    job.sampleRate = sampleRate;
+    job.data = data;
+    jobs.push_back(job);
+    if (!worker.joinable()) worker = std::thread(&SamplePool::run, this);
+    jobAdded.notify_one();
+    return data;
+}
+
+SamplePool::~SamplePool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAdded.notify_one();
+    if (worker.joinable()) worker.join();
+}
+
+void SamplePool::run() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAdded.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = jobs.front();
+            jobs.pop_front();
+        }
+        load(job.path, job.sampleRate, *job.data);
+    }
+}
+
+void SamplePool::load(const std::string& path, float sampleRate, SampleData& data) {
+    SourceInfo info;
+    std::string cachePath = getCachePath(path, sampleRate, data.format);
+    bool haveSource = getSourceInfo(path, info);
+    SampleCacheHeader header;
+    if (haveSource && mapCache(cachePath, info, data.format, data.mapping, header)) {
+        data.compactScale = header.compactScale;
+        assignLevels(data, data.mapping.data() + header.dataOffset, header.length);
+        data.nativeRate = header.sampleRate;
+        INFO("Mapped cached sample: %s", cachePath.c_str());
+    }
+    else if (decode(path, data)) {
+        if (sampleRate > 0.f && sampleRate != data.nativeRate && !data.buffer.empty()) {
+            // Resample once here so playback can step through frames one per engine sample
+            size_t outLength = (size_t)std::llround((double)data.buffer.size() * sampleRate / data.nativeRate);
+            std::vector<float> resampled;
+            SincResampler(sampleRate / data.nativeRate).process(data.buffer.data(), data.buffer.size(), std::max<size_t>(outLength, 1), resampled);
+            INFO("Resampled %s from %.0f Hz to %.0f Hz", path.c_str(), data.nativeRate, sampleRate);
+            data.buffer.swap(resampled);
+            data.nativeRate = sampleRate;
+        }
+        buildLevels(data);
+        if (data.format == SAMPLE_INT16) compact(data);
+        if (haveSource && data.length > 0) {
+            const void* packed = (data.format == SAMPLE_INT16) ? (const void*)data.compactBuffer.data() : (const void*)data.buffer.data();
+            writeCache(cachePath, info, data, packed);
+        }
+    }
+    else {
+        assignLevels(data, nullptr, 0);
+    }
+    data.ready.store(true, std::memory_order_release);
+}
+
+
+// --- Snapshots ---
+// A snapshot is a ready sample written out in the cache format, wherever the
+// caller keeps it (Thrum puts its user sample in the patch storage
+// directory). Unlike a cache entry it is not checked against its source, so
+// it still opens after the WAV has moved or changed.
+bool SamplePool::saveSnapshot(const SampleData& data, const std::string& snapshotPath, const std::string& sourcePath) {
+    if (!data.isPlayable()) return false;
+    SourceInfo info;
+    getSourceInfo(sourcePath, info);
+    // The levels are packed back to back, each behind its guard frames
+    const void* packed = (data.format == SAMPLE_INT16)
+        ? (const void*)(data.levels[0].compactFrames - SAMPLE_GUARD_FRAMES)
+        : (const void*)(data.levels[0].frames - SAMPLE_GUARD_FRAMES);
+    return writeCache(snapshotPath, info, data, packed);
+}
+
+// Maps the snapshot on the calling thread, which only costs a file open.
+// The handle is ready on return, in whichever format was saved; null if the
+// file is missing or malformed.
+SampleHandle SamplePool::openSnapshot(const std::string& snapshotPath) {
+    std::shared_ptr<SampleData> data = std::make_shared<SampleData>();
+    SampleCacheHeader header;
+    if (!mapCacheFile(snapshotPath, data->mapping, header)) return nullptr;
+    data->format = (SampleFormat)header.format;
+    data->compactScale = header.compactScale;
+    assignLevels(*data, data->mapping.data() + header.dataOffset, header.length);
+    data->nativeRate = header.sampleRate;
+    data->ready.store(true, std::memory_order_release);
+    INFO("Mapped sample snapshot: %s", snapshotPath.c_str());
+    return data;
+}
+
+
+// --- Mip Levels ---
+// Replaces the level-0 frames in data.buffer with the packed layout: for each
+// level, SAMPLE_GUARD_FRAMES wrapped from its end, the level, then
+// SAMPLE_GUARD_FRAMES wrapped from its start. Levels above 0 are produced by
+// the windowed-sinc resampler, which low-passes them to their own Nyquist.
+void SamplePool::buildLevels(SampleData& data) {
+    std::vector<float> base;
+    base.swap(data.buffer);
+    size_t length = base.size();
+    if (length == 0) { assignLevels(data, nullptr, 0); return; }
+
+    data.buffer.resize(getPackedSize(length));
+    float* out = data.buffer.data();
+    std::vector<float> decimated;
+    for (int level = 0; level < SAMPLE_MIP_LEVELS; ++level) {
+        size_t levelLength = getLevelLength(length, level);
+        const float* frames = base.data();
+        if (level > 0) {
+            SincResampler((double)levelLength / length).process(base.data(), length, levelLength, decimated);
+            frames = decimated.data();
+        }
+        for (size_t g = 0; g < SAMPLE_GUARD_FRAMES; ++g) {
+            out[g] = frames[(levelLength - (SAMPLE_GUARD_FRAMES - g) % levelLength) % levelLength];
+            out[SAMPLE_GUARD_FRAMES + levelLength + g] = frames[g % levelLength];
+        }
+        memcpy(out + SAMPLE_GUARD_FRAMES, frames, levelLength * sizeof(float));
+        out += levelLength + 2 * SAMPLE_GUARD_FRAMES;
+    }
+    assignLevels(data, data.buffer.data(), length);
+}
+
+// Replaces the packed float levels with 16-bit frames scaled to the
+// sample's peak, then frees the float copy
+void SamplePool::compact(SampleData& data) {
+    float peak = 0.f;
+    for (float x : data.buffer) peak = std::max(peak, std::fabs(x));
+    data.compactScale = (peak > 0.f) ? peak / 32767.f : 1.f;
+    float toSteps = 1.f / data.compactScale;
+    data.compactBuffer.resize(data.buffer.size());
+    for (size_t i = 0; i < data.buffer.size(); ++i)
+        data.compactBuffer[i] = (int16_t)std::max(-32767.f, std::min(32767.f, std::round(data.buffer[i] * toSteps)));
+    std::vector<float>().swap(data.buffer);
+    assignLevels(data, data.compactBuffer.data(), data.length);
+}
+
+// `packed` holds float or int16_t frames, by data.format
+void SamplePool::assignLevels(SampleData& data, const void* packed, size_t length) {
+    data.length = length;
+    size_t offset = SAMPLE_GUARD_FRAMES;
+    for (int level = 0; level < SAMPLE_MIP_LEVELS; ++level) {
+        size_t levelLength = (length > 0) ? getLevelLength(length, level) : 0;
+        SampleLevel& mip = data.levels[level];
+        mip.frames = (packed && data.format == SAMPLE_FLOAT32) ? static_cast<const float*>(packed) + offset : nullptr;
+        mip.compactFrames = (packed && data.format == SAMPLE_INT16) ? static_cast<const int16_t*>(packed) + offset : nullptr;
+        mip.length = levelLength;
+        offset += levelLength + 2 * SAMPLE_GUARD_FRAMES;
+    }
+    data.frames = data.levels[0].frames;
+}
+
+
+// --- Helper Function: Sample Decoding ---
+bool SamplePool::decode(const std::string& path, SampleData& outData) {
+    unsigned int channels;
+    unsigned int loadedSampleRate;
+    drwav_uint64 totalPcmFrameCount;
+    float* pSampleData = nullptr;
+    outData.buffer.clear();
+    outData.nativeRate = 0.f;
+    pSampleData = drwav_open_file_and_read_pcm_frames_f32(path.c_str(), &channels, &loadedSampleRate, &totalPcmFrameCount, NULL);
+    if (pSampleData == NULL) { WARN("Failed to load WAV file: %s", path.c_str()); return false; }
+    INFO("Loaded sample: %s, Channels: %d, Sample Rate: %d, Frames: %llu", path.c_str(), channels, loadedSampleRate, (unsigned long long)totalPcmFrameCount);
+    outData.nativeRate = (float)loadedSampleRate;
+    try {
+        outData.buffer.resize(totalPcmFrameCount);
+        if (channels == 1) { memcpy(outData.buffer.data(), pSampleData, totalPcmFrameCount * sizeof(float)); }
+        else if (channels > 1) {
+            for (drwav_uint64 i = 0; i < totalPcmFrameCount; ++i) {
+                float monoSample = 0.f;
+                for (unsigned int c = 0; c < channels; ++c) { monoSample += pSampleData[i * channels + c]; }
+                outData.buffer[i] = monoSample / channels;
+            }
+        } else { WARN("Sample has 0 channels? %s", path.c_str()); drwav_free(pSampleData, NULL); return false; }
+    } catch (const std::exception& e) { WARN("Exception processing sample buffer for %s: %s", path.c_str(), e.what()); drwav_free(pSampleData, NULL); return false; }
+    drwav_free(pSampleData, NULL);
+    return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <rack.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MappedFile.hpp"
+
+// Mip levels kept per sample for pitched playback: level L is low-passed and
+// decimated by 2^L, so reading it at up to two frames per output sample
+// covers rates below 2^(L+1) without aliasing
+constexpr int SAMPLE_MIP_LEVELS = 3;
+// Wrapped frames stored either side of every level, so the playback
+// interpolator can read across the loop point without bounds checks
+constexpr size_t SAMPLE_GUARD_FRAMES = 16;
+
+// How resident frames are stored. SAMPLE_INT16 halves the memory of
+// SAMPLE_FLOAT32: each sample is scaled so its peak fills the 16-bit range,
+// which puts the quantization floor near -96 dB of the sample's own peak,
+// and playback widens the frames to float as it interpolates.
+enum SampleFormat {
+    SAMPLE_FLOAT32,
+    SAMPLE_INT16
+};
+
+struct SampleLevel {
+    // Exactly one of these is set, by the sample's format.
+    // frames[-SAMPLE_GUARD_FRAMES, length + SAMPLE_GUARD_FRAMES) is readable.
+    const float* frames = nullptr;
+    const int16_t* compactFrames = nullptr; // Value = compactFrames[i] * SampleData::compactScale
+    size_t length = 0;
+};
+
+// Decoded, mono-mixed sample, resampled to the rate it was requested at. The
+// pool's worker fills it in and then
+// publishes `ready`; from then on it is immutable and safe to read from the
+// audio thread. Until then (or if loading failed) modules treat it as silence.
+struct SampleData {
+    const float* frames = nullptr; // Level 0 of a SAMPLE_FLOAT32 sample; points into `buffer` or the mapped cache file
+    size_t length = 0;
+    float nativeRate = 44100.f; // Rate of `frames` (the requested engine rate once resampled)
+    SampleLevel levels[SAMPLE_MIP_LEVELS];
+    SampleFormat format = SAMPLE_FLOAT32;
+    float compactScale = 1.f; // Value of one SAMPLE_INT16 step
+
+    bool isReady() const { return ready.load(std::memory_order_acquire); }
+    bool isPlayable() const { return isReady() && length > 0; }
+
+    // Bytes of frames held by all levels, guards included (0 until ready)
+    size_t getResidentBytes() const {
+        if (!isReady()) return 0;
+        size_t frames = 0;
+        for (int level = 0; level < SAMPLE_MIP_LEVELS; ++level)
+            if (levels[level].length > 0) frames += levels[level].length + 2 * SAMPLE_GUARD_FRAMES;
+        return frames * ((format == SAMPLE_INT16) ? sizeof(int16_t) : sizeof(float));
+    }
+
+private:
+    friend struct SamplePool;
+    std::atomic<bool> ready{false};
+    std::vector<float> buffer;
+    std::vector<int16_t> compactBuffer;
+    MappedFile mapping;
+};
+
+typedef std::shared_ptr<const SampleData> SampleHandle;
+
+// --- Plugin-wide Sample Pool ---
+// Each file is loaded once; every module holding a handle shares the same
+// buffer. The pool only keeps weak references, so an entry is released when
+// the last module using it goes away and loaded again on next demand.
+//
+// Loading happens on a background worker. acquire() returns at once with a
+// handle that becomes ready later. The worker first looks for a decoded copy
+// in the user folder's sample cache and maps it straight into memory; only on
+// a cache miss does it run dr_wav (and the windowed-sinc resampler when a
+// target rate is given), and it then writes the cache for next time. The
+// worker starts with the first load and is stopped and joined when the pool
+// is destroyed, as the plugin unloads; loads still queued then are dropped.
+struct SamplePool {
+    static SamplePool& instance();
+    ~SamplePool();
+
+    // sampleRate > 0 requests a copy resampled to that rate; 0 keeps the file's own rate.
+    // Each format is a separate entry.
+    SampleHandle acquire(const std::string& path, float sampleRate = 0.f, SampleFormat format = SAMPLE_FLOAT32);
+
+    // Standalone copies of a ready sample, outside the pool (see SamplePool.cpp)
+    static bool saveSnapshot(const SampleData& data, const std::string& snapshotPath, const std::string& sourcePath);
+    static SampleHandle openSnapshot(const std::string& snapshotPath);
+
+private:
+    struct Job {
+        std::string path;
+        float sampleRate;
+        std::shared_ptr<SampleData> data;
+    };
+
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<const SampleData>> entries;
+    std::deque<Job> jobs;
+    std::condition_variable jobAdded;
+    bool stopping = false;
+    std::thread worker;
+
+    void run();
+    static void load(const std::string& path, float sampleRate, SampleData& data);
+    static bool decode(const std::string& path, SampleData& outData);
+    static void buildLevels(SampleData& data);
+    static void compact(SampleData& data);
+    static void assignLevels(SampleData& data, const void* packed, size_t length);
+};
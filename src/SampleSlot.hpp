@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+
+// --- Lock-free Sample Handoff ---
+// Passes sample buffers from the UI thread to the audio thread with no
+// locks, allocation or frees on the audio side. The UI thread publishes a
+// heap-allocated T. The audio thread takes it as `next`, swaps it in as
+// `current` at a point of its choosing, and retires the value it replaces
+// for the UI thread to delete. Each value has one owner at a time, and each
+// handover between threads is a single atomic exchange or store:
+// - pending: published, not taken yet; publishing again deletes it
+// - next, current: the audio thread's
+// - retired: finished with, until reclaim() deletes it on the UI thread
+// There is room for one retired value, so the audio thread only lets go of
+// a value once the last one has been reclaimed, and keeps what it has until
+// then.
+template <typename T>
+struct SampleSlot {
+    SampleSlot() {}
+    ~SampleSlot() {
+        delete pending.load();
+        delete retired.load();
+        delete next;
+        delete current;
+    }
+    SampleSlot(const SampleSlot&) = delete;
+    SampleSlot& operator=(const SampleSlot&) = delete;
+
+    // --- UI thread ---
+    // Takes ownership of `value`, which must not be null
+    void publish(T* value) {
+        reclaim();
+        delete pending.exchange(value, std::memory_order_acq_rel);
+    }
+
+    void reclaim() {
+        delete retired.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    // --- Audio thread ---
+    // Takes the latest published value, if any, and returns what is next in
+    // line. A newer value supersedes one that was never swapped in, as long
+    // as there is room to retire the old one.
+    T* poll() {
+        if (pending.load(std::memory_order_relaxed) && (!next || canRetire())) {
+            T* taken = pending.exchange(nullptr, std::memory_order_acq_rel);
+            if (next) retired.store(next, std::memory_order_release);
+            next = taken;
+        }
+        return next;
+    }
+
+    bool canSwap() const { return next && (!current || canRetire()); }
+
+    // Makes `next` current; only if canSwap()
+    void swap() {
+        if (current) retired.store(current, std::memory_order_release);
+        current = next;
+        next = nullptr;
+    }
+
+    T* getCurrent() const { return current; }
+
+private:
+    std::atomic<T*> pending{nullptr};
+    std::atomic<T*> retired{nullptr};
+    T* next = nullptr;
+    T* current = nullptr;
+
+    // Only the audio thread fills `retired`, so once empty it stays empty until swap()
+    bool canRetire() const { return !retired.load(std::memory_order_acquire); }
+};
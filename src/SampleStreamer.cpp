@@ -0,0 +1,129 @@
+#include "SampleStreamer.hpp"
+
+#include <rack.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// --- dr_wav ---
+#include "dr_wav.h"
+// --- end dr_wav ---
+
+struct SampleStreamer::Decoder {
+    drwav wav;
+};
+
+
+SampleStreamer::SampleStreamer() {
+    ring.assign(STREAM_RING_FRAMES, 0.f);
+}
+
+SampleStreamer::~SampleStreamer() {
+    close();
+}
+
+bool SampleStreamer::shouldStream(const std::string& path) {
+    drwav wav;
+    if (!drwav_init_file(&wav, path.c_str(), NULL)) return false;
+    bool isLong = wav.totalPCMFrameCount > STREAM_THRESHOLD_FRAMES;
+    drwav_uninit(&wav);
+    return isLong;
+}
+
+bool SampleStreamer::open(const std::string& path) {
+    close();
+    decoder = new Decoder;
+    if (!drwav_init_file(&decoder->wav, path.c_str(), NULL)) {
+        WARN("Failed to open WAV file for streaming: %s", path.c_str());
+        delete decoder; decoder = nullptr;
+        return false;
+    }
+    channels = decoder->wav.channels;
+    nativeRate = (float)decoder->wav.sampleRate;
+    length = decoder->wav.totalPCMFrameCount;
+    if (channels == 0 || length == 0) { WARN("Empty WAV file: %s", path.c_str()); close(); return false; }
+    INFO("Streaming sample: %s, Channels: %u, Sample Rate: %.0f, Frames: %llu", path.c_str(), channels, nativeRate, (unsigned long long)length);
+
+    interleaved.assign(STREAM_BLOCK_FRAMES * channels, 0.f);
+    block.assign(STREAM_BLOCK_FRAMES, 0.f);
+
+    // Keep the start of the file resident for the loop wraparound
+    size_t headFrames = (size_t)std::min<uint64_t>(STREAM_LOOP_HEAD_FRAMES, length);
+    loopHead.assign(headFrames, 0.f);
+    fileCursor = 0;
+    size_t got = 0;
+    while (got < headFrames) {
+        size_t n = readFrames(loopHead.data() + got, std::min(headFrames - got, STREAM_BLOCK_FRAMES));
+        if (n == 0) break;
+        got += n;
+    }
+
+    streamPosition = 0;
+    writeIndex.store(0);
+    readIndex.store(0);
+    underruns.store(0);
+    running = true;
+    reader = std::thread(&SampleStreamer::run, this);
+    return true;
+}
+
+void SampleStreamer::close() {
+    running = false;
+    if (reader.joinable()) reader.join();
+    if (decoder) {
+        drwav_uninit(&decoder->wav);
+        delete decoder;
+        decoder = nullptr;
+    }
+}
+
+size_t SampleStreamer::readFrames(float* mono, size_t frames) {
+    frames = std::min(frames, STREAM_BLOCK_FRAMES);
+    size_t n = (size_t)drwav_read_pcm_frames_f32(&decoder->wav, frames, interleaved.data());
+    for (size_t i = 0; i < n; ++i) {
+        float monoSample = 0.f;
+        for (unsigned c = 0; c < channels; ++c) monoSample += interleaved[i * channels + c];
+        mono[i] = monoSample / channels;
+    }
+    fileCursor += n;
+    return n;
+}
+
+void SampleStreamer::push(const float* frames, size_t count) {
+    uint64_t w = writeIndex.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i)
+        ring[(w + i) & (STREAM_RING_FRAMES - 1)] = frames[i];
+    writeIndex.store(w + count, std::memory_order_release);
+}
+
+void SampleStreamer::run() {
+    const uint64_t headFrames = loopHead.size();
+    while (running) {
+        uint64_t filled = writeIndex.load(std::memory_order_relaxed) - readIndex.load(std::memory_order_acquire);
+        if (STREAM_RING_FRAMES - filled < STREAM_BLOCK_FRAMES) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+
+        size_t count = (size_t)std::min<uint64_t>(STREAM_BLOCK_FRAMES, length - streamPosition);
+        if (streamPosition < headFrames) {
+            // Loop head: served from memory while the decoder is already
+            // positioned just past it
+            count = (size_t)std::min<uint64_t>(count, headFrames - streamPosition);
+            push(loopHead.data() + streamPosition, count);
+            if (fileCursor != headFrames && drwav_seek_to_pcm_frame(&decoder->wav, headFrames))
+                fileCursor = headFrames;
+        }
+        else {
+            if (fileCursor != streamPosition && drwav_seek_to_pcm_frame(&decoder->wav, streamPosition))
+                fileCursor = streamPosition;
+            size_t n = readFrames(block.data(), count);
+            // A short read means a truncated file; pad so the loop keeps its length
+            std::fill(block.begin() + n, block.begin() + count, 0.f);
+            push(block.data(), count);
+        }
+
+        streamPosition += count;
+        if (streamPosition >= length) streamPosition = 0;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Disk Streaming ---
+// Files longer than STREAM_THRESHOLD_FRAMES are played from disk instead of
+// being decoded into memory. A reader thread keeps a lock-free single-producer/
+// single-consumer ring filled ahead of the audio thread and loops the file
+// seamlessly: the first STREAM_LOOP_HEAD_FRAMES are kept resident, so at the
+// loop point the ring is fed from memory while the reader seeks back into the
+// file. Memory per stream is bounded by the ring, the loop head and one block,
+// regardless of file length.
+constexpr uint64_t STREAM_THRESHOLD_FRAMES = 1 << 21; // ~47 s at 44.1 kHz
+constexpr size_t STREAM_RING_FRAMES = 1 << 17;         // ~3 s at 44.1 kHz, power of two
+constexpr size_t STREAM_BLOCK_FRAMES = 4096;
+constexpr size_t STREAM_LOOP_HEAD_FRAMES = 1 << 16;
+
+struct SampleStreamer {
+    SampleStreamer();
+    ~SampleStreamer(); // Stops and joins the reader thread
+    SampleStreamer(const SampleStreamer&) = delete;
+    SampleStreamer& operator=(const SampleStreamer&) = delete;
+
+    // True if the file is long enough that it should stream rather than load
+    static bool shouldStream(const std::string& path);
+
+    // Opens the file, preloads the loop head and starts the reader (UI thread)
+    bool open(const std::string& path);
+
+    float getNativeRate() const { return nativeRate; }
+    uint64_t getLength() const { return length; }
+    uint64_t getUnderruns() const { return underruns.load(std::memory_order_relaxed); }
+    // Buffers are sized by open() and fixed from then on
+    size_t getResidentBytes() const { return (ring.size() + loopHead.size() + interleaved.size() + block.size()) * sizeof(float); }
+
+    // Next mono frame of the looping stream (audio thread). Returns 0 if the
+    // reader has fallen behind.
+    float pop() {
+        uint64_t r = readIndex.load(std::memory_order_relaxed);
+        if (r == writeIndex.load(std::memory_order_acquire)) {
+            underruns.fetch_add(1, std::memory_order_relaxed);
+            return 0.f;
+        }
+        float frame = ring[r & (STREAM_RING_FRAMES - 1)];
+        readIndex.store(r + 1, std::memory_order_release);
+        return frame;
+    }
+
+private:
+    struct Decoder; // dr_wav state, kept out of this header
+    Decoder* decoder = nullptr;
+    unsigned channels = 0;
+    float nativeRate = 44100.f;
+    uint64_t length = 0;
+
+    std::vector<float> ring;
+    std::atomic<uint64_t> writeIndex{0};
+    std::atomic<uint64_t> readIndex{0};
+    std::atomic<uint64_t> underruns{0};
+
+    // Reader-thread state
+    std::vector<float> loopHead;
+    std::vector<float> interleaved;
+    std::vector<float> block;
+    uint64_t streamPosition = 0; // Next frame (within the loop) to push
+    uint64_t fileCursor = 0;     // Frame the decoder will read next
+    std::thread reader;
+    std::atomic<bool> running{false};
+
+    void run();
+    size_t readFrames(float* mono, size_t frames);
+    void push(const float* frames, size_t count);
+    void close();
+};
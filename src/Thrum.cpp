@@ -1,306 +1,785 @@
-#include "Thrum.hpp" // Module header FIRST
-#include "rack.hpp" // Explicitly include rack.hpp here too
-
-// VCV Rack Headers
-#include "plugin.hpp"
-#include "asset.hpp"
-#include "dsp/approx.hpp" // For clamp/common math
-
-// Standard Library Headers
-#include <vector>
-#include <cmath>    // Provides powf, fmaxf, fminf, fmod, exp
-#include <stdexcept>
-#include <string> // For std::string, std::to_string
-#include <utility> // For std::pair
-#include <cstdio> // For snprintf
-
-// --- dr_wav ---
-#include "dr_wav.h"
-// --- end dr_wav ---
-
-// Custom Widget/Component Headers
-#include "componentlibrary.hpp"
-#include "widgets/Magpie125.hpp"
-#include "widgets/Song60.hpp"
-
-extern rack::Plugin* pluginInstance;
-
-// --- Custom ParamQuantity for Duration Display ---
-struct DurationParamQuantity : rack::engine::ParamQuantity {
-	std::string getDisplayValueString() override {
-		float internalValue = getValue();
-		const float minDuration = 0.05f;
-		const float maxDuration = 3.0f;
-		float calculatedDuration = minDuration * powf(maxDuration / minDuration, internalValue);
-		char buffer[50];
-		snprintf(buffer, sizeof(buffer), "%.2f s", calculatedDuration);
-		return std::string(buffer);
-	}
-};
-
-
-// --- Helper Functions: Envelope Segments ---
-static const float k = 5.f;
-static float attackSegment(float t, float p) {
-    if (p <= 1e-6f) return 10.f;
-    float v = (p - t) / p;
-    v = fmaxf(v, 0.f);
-    float num = std::exp(-k * v) - std::exp(-k);
-    float den = 1.f - std::exp(-k);
-    if (std::abs(den) < 1e-6f) return (t <= p) ? 10.f : 0.f;
-    return rack::clamp(10.f * (num / den), 0.f, 10.f);
-}
-static float decaySegment(float t, float activeDuration, float p) {
-    float decayDur = activeDuration - p;
-    if (decayDur <= 1e-6f) return 0.f;
-    float u = (t - p) / decayDur;
-    u = rack::clamp(u, 0.f, 1.f);
-    float num = std::exp(-k * u) - std::exp(-k);
-    float den = 1.f - std::exp(-k);
-    if (std::abs(den) < 1e-6f) return 0.f;
-    return rack::clamp(10.f * (num / den), 0.f, 10.f);
-}
-
-
-// --- Helper Function: Sample Loading ---
-bool Thrum::loadSample(const std::string& path, SampleData& outData) {
-    unsigned int channels;
-    unsigned int loadedSampleRate;
-    drwav_uint64 totalPcmFrameCount;
-    float* pSampleData = nullptr;
-    outData.buffer.clear();
-    outData.nativeRate = 0.f;
-    pSampleData = drwav_open_file_and_read_pcm_frames_f32(path.c_str(), &channels, &loadedSampleRate, &totalPcmFrameCount, NULL);
-    if (pSampleData == NULL) { WARN("Failed to load WAV file: %s", path.c_str()); return false; }
-    INFO("Loaded sample: %s, Channels: %d, Sample Rate: %d, Frames: %llu", path.c_str(), channels, loadedSampleRate, totalPcmFrameCount);
-    outData.nativeRate = (float)loadedSampleRate;
-    try {
-        outData.buffer.resize(totalPcmFrameCount);
-        if (channels == 1) { memcpy(outData.buffer.data(), pSampleData, totalPcmFrameCount * sizeof(float)); }
-        else if (channels > 1) {
-            for (drwav_uint64 i = 0; i < totalPcmFrameCount; ++i) {
-                float monoSample = 0.f;
-                for (unsigned int c = 0; c < channels; ++c) { monoSample += pSampleData[i * channels + c]; }
-                outData.buffer[i] = monoSample / channels;
-            }
-        } else { WARN("Sample has 0 channels? %s", path.c_str()); drwav_free(pSampleData, NULL); return false; }
-    } catch (const std::exception& e) { WARN("Exception processing sample buffer for %s: %s", path.c_str(), e.what()); drwav_free(pSampleData, NULL); return false; }
-    drwav_free(pSampleData, NULL);
-    return true;
-}
-
-
-// --- Thrum Constructor ---
-Thrum::Thrum() {
-    config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-
-    // --- Configure Parameters ---
-    configParam<DurationParamQuantity>(TOTAL_DURATION_PARAM, 0.f, 1.f, 0.5f, "Duration");
-    configParam(DUTY_CYCLE_PARAM, 0.f, 1.f, 0.5f, "Duty Cycle", "%", 0.f, 100.f);
-    configParam(BIAS_PARAM, 0.f, 1.f, 0.5f, "Bias");
-    configParam(DURATION_ATTEN_PARAM, -1.f, 1.f, 0.f, "Duration CV Atten");
-    configParam(DUTY_ATTEN_PARAM, -1.f, 1.f, 0.f, "Duty Cycle CV Atten");
-    configParam(BIAS_ATTEN_PARAM, -1.f, 1.f, 0.f, "Bias CV Atten");
-
-    // --- Configure Inputs (with Tooltips/Labels) ---
-    configInput(CLOCK_INPUT, "Clock/Trigger Input");
-    configInput(AUDIO_INPUT, "Audio Input");
-    configInput(DURATION_CV_INPUT, "Duration CV Input");
-    configInput(DUTY_CV_INPUT, "Duty Cycle CV Input");
-    configInput(BIAS_CV_INPUT, "Bias CV Input");
-
-    // --- Configure Outputs (with Tooltips/Labels) ---
-    configOutput(AUDIO_OUTPUT, "Audio Output");
-    configOutput(ENV_OUTPUT, "Envelope Output");
-
-
-    // --- Sample Loading Logic ---
-    isRunning = false; prevGateHigh = false; clockPhase = 0.f; phase = 0.f;
-    samplePlaybackPhase = 0.0; currentSampleIndex = 0;
-    const std::vector<std::pair<std::string, std::string>> sampleFiles = {
-        {"res/sounds/EngineRoom.wav", "Engine Room"},
-        {"res/sounds/AlienBreath.wav", "Alien Breath"},
-        {"res/sounds/Siren.wav", "Siren"}
-    };
-    loadedSamples.clear();
-    std::vector<std::string> sampleDisplayNames;
-    loadedSamples.reserve(sampleFiles.size());
-    sampleDisplayNames.reserve(sampleFiles.size());
-    for (const auto& filePair : sampleFiles) {
-        const std::string& relPath = filePair.first; const std::string& displayName = filePair.second;
-        try {
-            std::string fullPath = asset::plugin(pluginInstance, relPath); SampleData loadedData;
-            if (loadSample(fullPath, loadedData)) {
-                loadedSamples.push_back(loadedData); sampleDisplayNames.push_back(displayName);
-            } else { WARN("Skipping sample: %s", relPath.c_str()); }
-        } catch (...) { WARN("Unknown exception loading: %s", relPath.c_str()); }
-    }
-    INFO("Finished loading samples. %zu samples loaded.", loadedSamples.size());
-    // --- End Sample Loading ---
-
-    // Configure Sample Select Param using configSwitch
-    int numSamples = loadedSamples.size();
-    float maxIndex = (numSamples > 0) ? (float)(numSamples - 1) : 0.f;
-    configSwitch(SAMPLE_SELECT_PARAM, 0.f, maxIndex, 0.f, "Sample", sampleDisplayNames);
-
-    onReset();
-}
-
-// --- onReset Method ---
-void Thrum::onReset() {
-    phase = 0.f; clockPhase = 0.f; isRunning = false; prevGateHigh = false;
-    samplePlaybackPhase = 0.0;
-    if (loadedSamples.empty()) { currentSampleIndex = -1; }
-    else { currentSampleIndex = rack::math::clamp(0, 0, (int)loadedSamples.size() - 1); }
-}
-
-
-// --- process Method ---
-void Thrum::process(const ProcessArgs& args) {
-
-    // --- Read Main Parameters ---
-    float durationKnobValue = params[TOTAL_DURATION_PARAM].getValue(); // Raw 0-1 value
-    float dutyBase = params[DUTY_CYCLE_PARAM].getValue();
-    float biasBase = params[BIAS_PARAM].getValue();
-
-    // --- Read CV Inputs and Attenuverters ---
-    float durationCv = inputs[DURATION_CV_INPUT].isConnected() ? inputs[DURATION_CV_INPUT].getVoltageSum() : 0.f;
-    float dutyCv = inputs[DUTY_CV_INPUT].isConnected() ? inputs[DUTY_CV_INPUT].getVoltageSum() : 0.f;
-    float biasCv = inputs[BIAS_CV_INPUT].isConnected() ? inputs[BIAS_CV_INPUT].getVoltageSum() : 0.f;
-
-    float durationAtten = params[DURATION_ATTEN_PARAM].getValue();
-    float dutyAtten = params[DUTY_ATTEN_PARAM].getValue();
-    float biasAtten = params[BIAS_ATTEN_PARAM].getValue();
-
-    // --- Apply CV Modulation ---
-    const float durationLinearCvScale = 0.1f;
-    const float dutyBiasCvScale = 0.1f;
-
-    float linearDurationValue = durationKnobValue + (durationCv * durationAtten * durationLinearCvScale);
-    linearDurationValue = rack::math::clamp(linearDurationValue, 0.f, 1.f);
-
-    const float minDuration = 0.05f;
-    const float maxDuration = 3.0f;
-    float totalDuration = minDuration * powf(maxDuration / minDuration, linearDurationValue);
-
-    float duty = dutyBase + (dutyCv * dutyAtten * dutyBiasCvScale);
-    float bias = biasBase + (biasCv * biasAtten * dutyBiasCvScale);
-
-    duty = rack::math::clamp(duty, 0.f, 1.f);
-    bias = rack::math::clamp(bias, 0.f, 1.f);
-
-    // --- Read Other Inputs ---
-    bool audioInputConnected = inputs[AUDIO_INPUT].isConnected();
-    float inVal = audioInputConnected ? inputs[AUDIO_INPUT].getVoltageSum() : 0.f;
-
-    // --- Sample Selection Logic ---
-    int desiredSampleIndex = static_cast<int>(params[SAMPLE_SELECT_PARAM].getValue());
-    if (!loadedSamples.empty()) {
-        if (desiredSampleIndex < 0) desiredSampleIndex = 0;
-        if (desiredSampleIndex >= (int)loadedSamples.size()) desiredSampleIndex = (int)loadedSamples.size() - 1;
-        if (desiredSampleIndex != currentSampleIndex) samplePlaybackPhase = 0.0;
-        currentSampleIndex = desiredSampleIndex;
-    } else { currentSampleIndex = -1; }
-    // --- End Sample Selection ---
-
-
-    // --- Envelope Calculation Logic ---
-    float envelopeDuration = totalDuration * rack::math::clamp(duty, 0.01f, 0.99f);
-    envelopeDuration = fmaxf(envelopeDuration, 1e-6f);
-    float peakFraction = rack::math::clamp(bias, 0.f, 1.f);
-    float p = envelopeDuration * peakFraction;
-    p = fmaxf(1e-6f, fminf(p, envelopeDuration - 1e-6f));
-
-    float env = 0.f; float t = 0.f; float calculatedEnv = 0.f;
-    bool printDebug = (++processCounter % 4096 == 0);
-
-    bool clocked = inputs[CLOCK_INPUT].isConnected();
-    if (clocked) { // Clocked Mode Logic
-        float gate = inputs[CLOCK_INPUT].getVoltageSum(); bool gateHigh = gate >= 1.f;
-        if (!prevGateHigh && gateHigh) { isRunning = true; clockPhase = 0.f; }
-        prevGateHigh = gateHigh;
-        if (isRunning) {
-            clockPhase += args.sampleTime; t = clockPhase;
-            if (clockPhase >= totalDuration) { isRunning = false; calculatedEnv = 0.f; }
-            else {
-                if (t <= envelopeDuration) { calculatedEnv = (t <= p) ? attackSegment(t, p) : decaySegment(t, envelopeDuration, p); }
-                else { calculatedEnv = 0.f; }
-            }
-        } else { calculatedEnv = 0.f; }
-        env = calculatedEnv;
-    } else { // Free-running Mode Logic
-        if (isRunning || prevGateHigh) { isRunning = false; clockPhase = 0.f; prevGateHigh = false; }
-        phase += args.sampleTime;
-        if (phase >= totalDuration) { phase -= totalDuration; if (phase < 0.f) phase = 0.f; }
-        t = phase;
-        if (t <= envelopeDuration) { calculatedEnv = (t <= p) ? attackSegment(t, p) : decaySegment(t, envelopeDuration, p); }
-        else { calculatedEnv = 0.f; }
-        env = calculatedEnv;
-    }
-    env = rack::math::clamp(env, 0.f, 10.f);
-    // --- End Envelope Calculation ---
-
-
-    // --- Audio Output Logic ---
-    float audioOutputValue = 0.f;
-    if (audioInputConnected) { audioOutputValue = inVal * (env / 10.f); }
-    else {
-        if (currentSampleIndex >= 0 && currentSampleIndex < (int)loadedSamples.size() && !loadedSamples[currentSampleIndex].buffer.empty()) {
-            const SampleData& currentSample = loadedSamples[currentSampleIndex]; const std::vector<float>& buffer = currentSample.buffer; size_t bufferSize = buffer.size();
-            if (bufferSize > 0) {
-                double phaseIncrement = currentSample.nativeRate / args.sampleRate; samplePlaybackPhase += phaseIncrement;
-                samplePlaybackPhase = fmod(samplePlaybackPhase, (double)bufferSize); if (samplePlaybackPhase < 0.0) { samplePlaybackPhase += bufferSize; }
-                int index0 = static_cast<int>(samplePlaybackPhase); int index1 = index0 + 1;
-                if (index1 >= (int)bufferSize) { index1 -= bufferSize; } if (index0 < 0 || index0 >= (int)bufferSize) { index0 = 0; }
-                float frac = samplePlaybackPhase - index0; float sampleValue = rack::math::crossfade(buffer[index0], buffer[index1], frac);
-                audioOutputValue = (sampleValue * 5.0f) * (env / 10.0f);
-            } else { audioOutputValue = 0.f; }
-        } else { audioOutputValue = 0.f; }
-    }
-    // --- End Audio Output ---
-
-    // Set Outputs
-    outputs[ENV_OUTPUT].setVoltage(env);
-    outputs[AUDIO_OUTPUT].setVoltage(audioOutputValue);
-}
-
-
-// --- ThrumWidget Constructor ---
-ThrumWidget::ThrumWidget(Thrum* module) {
-    setModule(module);
-    setPanel(createPanel(asset::plugin(pluginInstance, "res/Thrum.svg")));
-
-    // --- Add Controls Row by Row with User's Hardcoded Positions ---
-    // Tooltips are now handled by configInput/configOutput/configParam/configSwitch
-
-    // Duration Row (Y ~ 20-25)
-    addParam(createParamCentered<Magpie125>(mm2px(Vec(9.f, 20.f)), module, Thrum::TOTAL_DURATION_PARAM));
-    addParam(createParamCentered<Song60>(mm2px(Vec(23.f, 22.25f)), module, Thrum::DURATION_ATTEN_PARAM));
-    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34.f, 22.33f)), module, Thrum::DURATION_CV_INPUT));
-
-    // Duty Cycle Row (Y ~ 45-50)
-    addParam(createParamCentered<Magpie125>(mm2px(Vec(9.f, 39.f)), module, Thrum::DUTY_CYCLE_PARAM));
-    addParam(createParamCentered<Song60>(mm2px(Vec(23.f, 41.25f)), module, Thrum::DUTY_ATTEN_PARAM));
-    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34.f, 41.33f)), module, Thrum::DUTY_CV_INPUT));
-
-    // Bias Row (Y ~ 70-75)
-    addParam(createParamCentered<Magpie125>(mm2px(Vec(9.f, 58.f)), module, Thrum::BIAS_PARAM));
-    addParam(createParamCentered<Song60>(mm2px(Vec(23.f, 60.25f)), module, Thrum::BIAS_ATTEN_PARAM));
-    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34.f, 60.33f)), module, Thrum::BIAS_CV_INPUT));
-
-    // Sample Select Knob (Y ~ 95)
-    addParam(createParamCentered<Song60>(mm2px(Vec(24.f, 92.5f)), module, Thrum::SAMPLE_SELECT_PARAM));
-
-    // Bottom Row Jacks (User's Positions)
-    addInput (createInputCentered<PJ301MPort>(mm2px(Vec(9.f, 80.f)), module, Thrum::CLOCK_INPUT));
-    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(31.f, 105.f)), module, Thrum::AUDIO_OUTPUT));
-    addInput (createInputCentered<PJ301MPort>(mm2px(Vec(9.f, 105.f)), module, Thrum::AUDIO_INPUT));
-    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(31.f, 80.f)), module, Thrum::ENV_OUTPUT));
-
-    // Screws
-    addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
-    addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
-    addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-    addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-}
-
+#include "Thrum.hpp" // Module header FIRST
+#include "rack.hpp" // Explicitly include rack.hpp here too
+
+// VCV Rack Headers
+#include "plugin.hpp"
+#include "asset.hpp"
+#include "dsp/approx.hpp" // For clamp/common math
+
+// Standard Library Headers
+#include <vector>
+#include <cmath>    // Provides powf, fmaxf, fminf, fmod, exp
+#include <stdexcept>
+#include <string> // For std::string, std::to_string
+#include <utility> // For std::pair
+#include <cstdio> // For snprintf
+
+// Custom Widget/Component Headers
+#ifndef TERROIR_HEADLESS
+#include "componentlibrary.hpp"
+#include <osdialog.h>
+#include "widgets/Magpie125.hpp"
+#include "widgets/Song60.hpp"
+#endif
+
+extern rack::Plugin* pluginInstance;
+
+using simd::float_4;
+
+// --- Custom ParamQuantity for Duration Display ---
+struct DurationParamQuantity : rack::engine::ParamQuantity {
+	std::string getDisplayValueString() override {
+		float internalValue = getValue();
+		float calculatedDuration = ENVELOPE_MIN_DURATION * powf(ENVELOPE_MAX_DURATION / ENVELOPE_MIN_DURATION, internalValue);
+		char buffer[50];
+		snprintf(buffer, sizeof(buffer), "%.2f s", calculatedDuration);
+		return std::string(buffer);
+	}
+};
+
+
+// --- PITCH Input Range (octaves from the sample's own pitch) ---
+// Resident samples carry SAMPLE_MIP_LEVELS mip levels, which cover rates
+// below 2^SAMPLE_MIP_LEVELS; streams have only level 0, so they stop short of
+// twice their native rate.
+static const float PITCH_MIN_OCTAVES = -5.f;
+static const float PITCH_MAX_OCTAVES = SAMPLE_MIP_LEVELS - 0.01f;
+static const float STREAM_MAX_OCTAVES = 0.99f;
+static const float SAMPLE_SWITCH_SECONDS = 0.005f; // Each way: out to silence, then back in
+static_assert(SAMPLE_GUARD_FRAMES >= INTERP_HALF_TAPS, "Sample guard frames must cover the interpolator's half-width");
+
+
+// --- Thrum Constructor ---
+Thrum::Thrum() {
+    config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+
+    // --- Configure Parameters ---
+    configParam<DurationParamQuantity>(TOTAL_DURATION_PARAM, 0.f, 1.f, 0.5f, "Duration");
+    configParam(DUTY_CYCLE_PARAM, 0.f, 1.f, 0.5f, "Duty Cycle", "%", 0.f, 100.f);
+    configParam(BIAS_PARAM, 0.f, 1.f, 0.5f, "Bias");
+    configParam(DURATION_ATTEN_PARAM, -1.f, 1.f, 0.f, "Duration CV Atten");
+    configParam(DUTY_ATTEN_PARAM, -1.f, 1.f, 0.f, "Duty Cycle CV Atten");
+    configParam(BIAS_ATTEN_PARAM, -1.f, 1.f, 0.f, "Bias CV Atten");
+
+    // --- Configure Inputs (with Tooltips/Labels) ---
+    configInput(CLOCK_INPUT, "Clock/Trigger Input");
+    configInput(AUDIO_INPUT, "Audio Input");
+    configInput(DURATION_CV_INPUT, "Duration CV Input");
+    configInput(DUTY_CV_INPUT, "Duty Cycle CV Input");
+    configInput(BIAS_CV_INPUT, "Bias CV Input");
+    configInput(PITCH_INPUT, "Pitch (V/Oct)");
+
+    // --- Configure Outputs (with Tooltips/Labels) ---
+    configOutput(AUDIO_OUTPUT, "Audio Output");
+    configOutput(ENV_OUTPUT, "Envelope Output");
+
+
+    // --- Sample Loading Logic ---
+    currentSampleIndex = 0;
+    const std::vector<std::pair<std::string, std::string>> sampleFiles = {
+        {"res/sounds/EngineRoom.wav", "Engine Room"},
+        {"res/sounds/AlienBreath.wav", "Alien Breath"},
+        {"res/sounds/siren.wav", "Siren"}
+    };
+    // Handles are acquired at the engine rate in onSampleRateChange(), which
+    // Rack also dispatches when the module is added
+    samplePaths.clear();
+    std::vector<std::string> sampleDisplayNames;
+    samplePaths.reserve(sampleFiles.size());
+    sampleDisplayNames.reserve(sampleFiles.size());
+    for (const auto& filePair : sampleFiles) {
+        samplePaths.push_back(asset::plugin(pluginInstance, filePair.first));
+        sampleDisplayNames.push_back(filePair.second);
+    }
+    loadedSamples.resize(samplePaths.size());
+    // --- End Sample Loading ---
+
+    // Configure Sample Select Param using configSwitch
+    int numSamples = loadedSamples.size();
+    float maxIndex = (numSamples > 0) ? (float)(numSamples - 1) : 0.f;
+    configSwitch(SAMPLE_SELECT_PARAM, 0.f, maxIndex, 0.f, "Sample", sampleDisplayNames);
+
+    onReset();
+}
+
+// --- onReset Method ---
+void Thrum::onReset() {
+    for (int g = 0; g < 4; ++g) {
+        phase[g] = 0.f; prevGateHigh[g] = 0.f;
+        for (int v = 0; v < THRUM_MAX_VOICES; ++v) { voicePhase[v][g] = 0.f; voiceRunning[v][g] = 0.f; }
+        busySlots[g] = 0;
+    }
+    controlRate.invalidate();
+    resetPlayback();
+    if (samplePaths.empty()) { currentSampleIndex = -1; }
+    else { currentSampleIndex = rack::math::clamp(0, 0, (int)samplePaths.size() - 1); }
+    nextSampleIndex = currentSampleIndex;
+}
+
+
+// --- onSampleRateChange Method ---
+// Runs with the engine paused. Requests every resident sample at the new
+// rate; the pool resamples (or maps a cached resample) off the audio thread,
+// which keeps playing the old set until the new one is ready.
+void Thrum::onSampleRateChange(const SampleRateChangeEvent& e) {
+    engineSampleRate = e.sampleRate;
+    SampleFormat format = getSampleFormat();
+    std::vector<SampleHandle> newSamples;
+    for (const std::string& path : samplePaths)
+        newSamples.push_back(SamplePool::instance().acquire(path, e.sampleRate, format));
+    samplesAcquired = true;
+
+    std::lock_guard<std::mutex> lock(userSampleMutex);
+    loadedSamples.swap(newSamples);
+    if (userSample && !isUserSampleCurrent(e.sampleRate, format))
+        userSample = SamplePool::instance().acquire(userSamplePath, e.sampleRate, format);
+    publishSamples();
+}
+
+
+// --- Sample Format ---
+void Thrum::setCompactSamples(bool compact) {
+    if (compactSamples.exchange(compact) == compact) return;
+    // Before the first onSampleRateChange nothing is loaded yet, and that
+    // call acquires in the new format
+    if (!samplesAcquired) return;
+
+    float sampleRate = engineSampleRate;
+    SampleFormat format = getSampleFormat();
+    std::vector<SampleHandle> newSamples;
+    for (const std::string& path : samplePaths)
+        newSamples.push_back(SamplePool::instance().acquire(path, sampleRate, format));
+    std::string userPath;
+    {
+        std::lock_guard<std::mutex> lock(userSampleMutex);
+        if (userSample && !isUserSampleCurrent(sampleRate, format)) userPath = userSamplePath;
+    }
+    SampleHandle newUserSample;
+    if (!userPath.empty()) newUserSample = SamplePool::instance().acquire(userPath, sampleRate, format);
+
+    std::lock_guard<std::mutex> lock(userSampleMutex);
+    loadedSamples.swap(newSamples);
+    if (newUserSample && userSamplePath == userPath) userSample.swap(newUserSample);
+    publishSamples();
+    // The previous handles are released here; the audio thread's set holds its own
+}
+
+// Hands the selection to the audio thread as a new set. Only UI-side work
+// happens here, including opening a stream: a stream is read by one set only.
+void Thrum::publishSamples() {
+    ThrumSampleSet* set = new ThrumSampleSet;
+    set->bundled = loadedSamples;
+    set->userActive = !userSamplePath.empty();
+    set->user = userSample;
+    if (userStreamed) {
+        set->stream.reset(new SampleStreamer);
+        if (!set->stream->open(userSamplePath)) set->stream.reset();
+    }
+    samples.publish(set);
+}
+
+
+// --- User Sample Handling ---
+// `snapshot`, if given, is the sample restored from the patch and is used
+// in place of loading `path`
+void Thrum::loadUserSample(const std::string& path, SampleHandle snapshot) {
+    // Start the load outside the lock; only the swap is guarded
+    SampleHandle newSample = snapshot;
+    bool streamed = !newSample && SampleStreamer::shouldStream(path);
+    if (!newSample && !streamed) newSample = SamplePool::instance().acquire(path, engineSampleRate, getSampleFormat());
+
+    std::lock_guard<std::mutex> lock(userSampleMutex);
+    userSamplePath = path;
+    userSample.swap(newSample);
+    userStreamed = streamed;
+    publishSamples();
+    // The previous sample (now in newSample) is released here, off the audio thread
+}
+
+void Thrum::clearUserSample() {
+    SampleHandle oldSample;
+    std::lock_guard<std::mutex> lock(userSampleMutex);
+    userSamplePath.clear();
+    userSample.swap(oldSample);
+    userStreamed = false;
+    publishSamples();
+}
+
+// A ready user sample at this rate and format needs no reload. Neither does
+// one restored from the patch whose WAV is no longer there to reload from.
+bool Thrum::isUserSampleCurrent(float sampleRate, SampleFormat format) {
+    if (userSample->isPlayable() && userSample->nativeRate == sampleRate && userSample->format == format) return true;
+    return userSample->isPlayable() && !system::isFile(userSamplePath);
+}
+
+
+// --- Patch Storage ---
+// Saves a resident user sample with the patch as its decoded, engine-rate
+// levels, in the sample cache's file format, so opening the patch maps it
+// back instead of decoding the WAV (see dataFromJson()). It is only written
+// when the sample changes, not on every autosave. Each copy gets a new
+// random name, which the patch JSON records: a preset or a pasted module
+// names a file this module's storage doesn't have, and loads from its path.
+// Streamed files are too long to embed and always reopen from their path.
+void Thrum::onSave(const SaveEvent&) {
+    SampleHandle sample;
+    std::string path;
+    std::string oldName;
+    {
+        std::lock_guard<std::mutex> lock(userSampleMutex);
+        if (userSample && userSample->isPlayable()) {
+            sample = userSample;
+            path = userSamplePath;
+        }
+        if (sample && snapshotSample.lock() == sample) return;
+        oldName = snapshotName;
+    }
+    if (!sample && oldName.empty()) return;
+
+    std::string dir = createPatchStorageDirectory();
+    if (!oldName.empty()) system::remove(system::join(dir, oldName));
+    std::string name;
+    if (sample) {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "userSample-%016llx.bin", (unsigned long long)random::u64());
+        if (SamplePool::saveSnapshot(*sample, system::join(dir, buffer), path)) name = buffer;
+    }
+    std::lock_guard<std::mutex> lock(userSampleMutex);
+    snapshotName = name;
+    snapshotSample = name.empty() ? SampleHandle() : sample;
+}
+
+// The patch storage directory only exists for a module in the engine, so a
+// module being duplicated loads from the path instead
+SampleHandle Thrum::openUserSampleSnapshot(const std::string& name) {
+    if (id < 0 || name.empty()) return nullptr;
+    std::string snapshotPath = system::join(getPatchStorageDirectory(), name);
+    if (!system::isFile(snapshotPath)) return nullptr;
+    SampleHandle snapshot = SamplePool::openSnapshot(snapshotPath);
+    if (snapshot) {
+        std::lock_guard<std::mutex> lock(userSampleMutex);
+        snapshotName = name;
+        snapshotSample = snapshot;
+    }
+    return snapshot;
+}
+
+
+// --- Sample Playback ---
+void Thrum::resetPlayback() {
+    for (int c = 0; c < 16; ++c) playPosition[c] = 0.0;
+    playIndex = 0;
+    for (int v = 0; v < THRUM_MAX_VOICES; ++v)
+        for (int c = 0; c < 16; ++c) voicePosition[v][c] = 0.0;
+    for (int i = 0; i < 2 * INTERP_TAPS; ++i) streamHistory[i] = 0.f;
+    streamWrite = 0;
+    streamFrac = 0.0;
+}
+
+// Called at silence: takes the next set if it is ready and the SAMPLE
+// selection, and restarts the playheads on them
+void Thrum::switchSamples() {
+    const ThrumSampleSet* next = samples.poll();
+    if (next && next->isReady() && samples.canSwap()) samples.swap();
+    currentSampleIndex = nextSampleIndex;
+    resetPlayback();
+    sampleSwitching = false;
+}
+
+// Resident buffers are resampled to the engine rate by SamplePool, so
+// without PITCH playback is a plain integer-index loop on level 0.
+float Thrum::playResident(const SampleData& sample) {
+    const SampleLevel& mip = sample.levels[0];
+    if (playIndex >= sample.length) playIndex = 0;
+    float value = mip.compactFrames ? mip.compactFrames[playIndex] * sample.compactScale : mip.frames[playIndex];
+    if (++playIndex >= sample.length) playIndex = 0;
+    return value;
+}
+
+// Reads the playheads position[i] for each bit i set in `lanes`, each
+// advancing by its own rate (level-0 frames per engine sample); other lanes
+// read 0. Rates of 2 and above read the mip level that brings the residual
+// rate below 2, and the interpolator bank narrows the cutoff for the
+// residual, so upward sweeps stay band-limited.
+float_4 Thrum::playResident(const SampleData& sample, double* position, float_4 rate, int lanes) {
+    const PolyphaseKernel& kernel = PolyphaseKernel::get();
+    const DspKernels& kernels = DspKernels::get();
+    const double length = (double)sample.length;
+    float_4 out = 0.f;
+    for (int i = 0; i < 4; ++i) {
+        if (!(lanes & (1 << i))) continue;
+        float residual = rate[i];
+        int level = 0;
+        while (residual >= 2.f && level < SAMPLE_MIP_LEVELS - 1) { residual *= 0.5f; ++level; }
+        const SampleLevel& mip = sample.levels[level];
+
+        double& playhead = position[i];
+        double levelPosition = playhead * (mip.length / length);
+        size_t index = std::min((size_t)levelPosition, mip.length - 1);
+        float frac = (float)(levelPosition - index);
+        int bank = PolyphaseKernel::getBank(residual);
+        out[i] = mip.compactFrames
+            ? kernels.interpolateCompact(kernel, mip.compactFrames + index, frac, bank, sample.compactScale)
+            : kernels.interpolate(kernel, mip.frames + index, frac, bank);
+
+        playhead += rate[i];
+        if (playhead >= length) playhead = std::fmod(playhead, length);
+    }
+    return out;
+}
+
+// Moves the playheads exactly as playResident would, without reading the sample
+void Thrum::advanceResident(const SampleData& sample, double* position, float_4 rate, int lanes) {
+    const double length = (double)sample.length;
+    for (int i = 0; i < 4; ++i) {
+        if (!(lanes & (1 << i))) continue;
+        double& playhead = position[i];
+        playhead += rate[i];
+        if (playhead >= length) playhead = std::fmod(playhead, length);
+    }
+}
+
+// Frames arrive in order from the ring, so a stream has a single playhead.
+// The last INTERP_TAPS frames are kept for the interpolator; the read point
+// sits between the middle two, INTERP_HALF_TAPS frames behind the ring.
+float Thrum::playStream(SampleStreamer& stream, float rate) {
+    advanceStream(stream, rate);
+    const float* window = streamHistory + streamWrite; // Oldest to newest
+    return DspKernels::get().interpolate(PolyphaseKernel::get(), window + INTERP_HALF_TAPS - 1, (float)streamFrac, PolyphaseKernel::getBank(rate));
+}
+
+// Pulls the frames a playback step consumes into the history, so the ring
+// keeps moving while the stream isn't heard
+void Thrum::advanceStream(SampleStreamer& stream, float rate) {
+    streamFrac += rate;
+    while (streamFrac >= 1.0) {
+        float frame = stream.pop();
+        streamHistory[streamWrite] = frame;
+        streamHistory[streamWrite + INTERP_TAPS] = frame;
+        streamWrite = (streamWrite + 1) % INTERP_TAPS;
+        streamFrac -= 1.0;
+    }
+}
+
+
+// --- Voice Pool ---
+// Starts a voice on each channel set in `rising`. With a single slot the
+// edge restarts it, as a retrigger always has. Otherwise it takes the
+// channel's lowest free slot below `capacity`; once all of those are busy
+// it steals the oldest voice (the lowest slot on a tie), so a given clock
+// always lands the same way. The voice keeps the PITCH of its trigger and
+// starts reading from the channel's playhead.
+void Thrum::startVoices(int c, float_4 rising, int capacity) {
+    int g = c / 4;
+    float_4 pitch = 0.f;
+    if (inputs[PITCH_INPUT].isConnected())
+        pitch = simd::clamp(inputs[PITCH_INPUT].getPolyVoltageSimd<float_4>(c), PITCH_MIN_OCTAVES, PITCH_MAX_OCTAVES);
+    int lanes = simd::movemask(rising);
+    float_4 slot = 0.f;
+    for (int i = 0; i < 4; ++i) {
+        if (!(lanes & (1 << i))) continue;
+        int s = 0;
+        if (capacity > 1) {
+            while (s < capacity && (simd::movemask(voiceRunning[s][g]) & (1 << i))) ++s;
+            if (s == capacity) {
+                s = 0;
+                for (int v = 1; v < capacity; ++v)
+                    if (voicePhase[v][g][i] > voicePhase[s][g][i]) s = v;
+            }
+        }
+        slot[i] = (float)s;
+        voicePosition[s][c + i] = playPosition[c + i];
+    }
+    for (int v = 0; v < capacity; ++v) {
+        float_4 start = rising & (slot == (float)v);
+        voiceRunning[v][g] = voiceRunning[v][g] | start;
+        voicePhase[v][g] = simd::ifelse(start, 0.f, voicePhase[v][g]);
+        voicePitch[v][g] = simd::ifelse(start, pitch, voicePitch[v][g]);
+        if (simd::movemask(start) != 0) busySlots[g] |= 1 << v;
+    }
+}
+
+json_t* Thrum::dataToJson() {
+    json_t* rootJ = json_object();
+    std::lock_guard<std::mutex> lock(userSampleMutex);
+    if (!userSamplePath.empty()) json_object_set_new(rootJ, "userSamplePath", json_string(userSamplePath.c_str()));
+    if (userSample && !snapshotName.empty() && snapshotSample.lock() == userSample)
+        json_object_set_new(rootJ, "userSampleSnapshot", json_string(snapshotName.c_str()));
+    json_object_set_new(rootJ, "compactSamples", json_boolean(compactSamples.load()));
+    json_object_set_new(rootJ, "voices", json_integer(voiceCount.load()));
+    controlRate.dataToJson(rootJ);
+    return rootJ;
+}
+
+void Thrum::dataFromJson(json_t* rootJ) {
+    // Format first, so the user sample below loads in it
+    json_t* compactJ = json_object_get(rootJ, "compactSamples");
+    setCompactSamples(compactJ && json_is_true(compactJ));
+    json_t* pathJ = json_object_get(rootJ, "userSamplePath");
+    json_t* snapshotJ = json_object_get(rootJ, "userSampleSnapshot");
+    const char* snapshot = snapshotJ ? json_string_value(snapshotJ) : nullptr;
+    if (pathJ) loadUserSample(json_string_value(pathJ), openUserSampleSnapshot(snapshot ? snapshot : ""));
+    else clearUserSample();
+    json_t* voicesJ = json_object_get(rootJ, "voices");
+    if (voicesJ) voiceCount = clamp((int)json_integer_value(voicesJ), 1, THRUM_MAX_VOICES);
+    controlRate.dataFromJson(rootJ);
+}
+
+
+// --- Control Block ---
+// Channel count, sample selection and the envelope segment coefficients
+// follow knobs and CV; they are mapped here once per control block and held
+// until the next one. The envelope itself is still evaluated every sample.
+void Thrum::updateControls() {
+
+    // --- Channel Count: widest of the clock, audio and CV cables ---
+    channels = 1;
+    for (int i = 0; i < NUM_INPUTS; ++i) channels = std::max(channels, inputs[i].getChannels());
+
+    // --- Read Main Parameters ---
+    float durationKnobValue = params[TOTAL_DURATION_PARAM].getValue(); // Raw 0-1 value
+    float dutyBase = params[DUTY_CYCLE_PARAM].getValue();
+    float biasBase = params[BIAS_PARAM].getValue();
+
+    float durationAtten = params[DURATION_ATTEN_PARAM].getValue();
+    float dutyAtten = params[DUTY_ATTEN_PARAM].getValue();
+    float biasAtten = params[BIAS_ATTEN_PARAM].getValue();
+
+    bool durationCvConnected = inputs[DURATION_CV_INPUT].isConnected();
+    bool dutyCvConnected = inputs[DUTY_CV_INPUT].isConnected();
+    bool biasCvConnected = inputs[BIAS_CV_INPUT].isConnected();
+
+    const float durationLinearCvScale = 0.1f;
+    const float dutyBiasCvScale = 0.1f;
+
+    // --- Sample Selection Logic ---
+    int desiredSampleIndex = static_cast<int>(params[SAMPLE_SELECT_PARAM].getValue());
+    if (!samplePaths.empty()) {
+        if (desiredSampleIndex < 0) desiredSampleIndex = 0;
+        if (desiredSampleIndex >= (int)samplePaths.size()) desiredSampleIndex = (int)samplePaths.size() - 1;
+    } else { desiredSampleIndex = -1; }
+    nextSampleIndex = desiredSampleIndex;
+
+    // --- Sample Handoff: a ready set or a new selection starts a switch ---
+    const ThrumSampleSet* next = samples.poll();
+    bool nextReady = next && samples.canSwap() && next->isReady();
+    if (nextReady || nextSampleIndex != currentSampleIndex) {
+        // With nothing playing yet there is nothing to fade
+        if (!samples.getCurrent()) switchSamples();
+        else sampleSwitching = true;
+    }
+    // --- End Sample Selection ---
+
+    for (int c = 0; c < channels; c += 4) {
+        // --- Apply CV Modulation ---
+        float_4 linearDurationValue = durationKnobValue;
+        float_4 duty = dutyBase;
+        float_4 bias = biasBase;
+        if (durationCvConnected) linearDurationValue += inputs[DURATION_CV_INPUT].getPolyVoltageSimd<float_4>(c) * durationAtten * durationLinearCvScale;
+        if (dutyCvConnected) duty += inputs[DUTY_CV_INPUT].getPolyVoltageSimd<float_4>(c) * dutyAtten * dutyBiasCvScale;
+        if (biasCvConnected) bias += inputs[BIAS_CV_INPUT].getPolyVoltageSimd<float_4>(c) * biasAtten * dutyBiasCvScale;
+
+        linearDurationValue = simd::clamp(linearDurationValue, 0.f, 1.f);
+        duty = simd::clamp(duty, 0.f, 1.f);
+        bias = simd::clamp(bias, 0.f, 1.f);
+
+        // Duration curve and segment coefficients only recompute on change
+        envelopeShape[c / 4].update(linearDurationValue, duty, bias);
+    }
+}
+
+
+// --- process Method ---
+// Work is skipped wherever nobody can hear it: an envelope is only
+// evaluated while its voice is running and an output is patched, and sample
+// interpolation only runs for voices whose envelope is open on a patched
+// AUDIO output. Idle playheads still advance, so pitch and loop position
+// are where they would have been when the module wakes.
+void Thrum::process(const ProcessArgs& args) {
+    TERROIR_PROFILE_START(profiler);
+    if (controlRate.tick()) updateControls();
+    TERROIR_PROFILE_LAP(profiler, MAPPING_STAGE);
+
+    // --- Read Other Inputs ---
+    bool audioInputConnected = inputs[AUDIO_INPUT].isConnected();
+    bool clocked = inputs[CLOCK_INPUT].isConnected();
+    bool audioOutputConnected = outputs[AUDIO_OUTPUT].isConnected();
+    bool envOutputConnected = outputs[ENV_OUTPUT].isConnected();
+    bool envelopeNeeded = audioOutputConnected || envOutputConnected;
+    int capacity = voiceCount.load(std::memory_order_relaxed);
+
+    // --- Envelope Calculation Logic ---
+    // env[g] sums the group's voices. Only busy slots are visited; for
+    // those, voiceEnv/voiceLanes keep each voice's envelope and running
+    // lanes for the playback below.
+    float_4 env[4];
+    bool envelopeOpen[4] = {};
+    int visitedSlots[4] = {};
+    float_4 voiceEnv[THRUM_MAX_VOICES][4];
+    int voiceLanes[THRUM_MAX_VOICES][4];
+    for (int c = 0; c < channels; c += 4) {
+        int g = c / 4;
+        const EnvelopeShape4& shape = envelopeShape[g];
+        env[g] = 0.f;
+
+        if (clocked) { // Clocked Mode Logic
+            float_4 gateHigh = inputs[CLOCK_INPUT].getPolyVoltageSimd<float_4>(c) >= 1.f;
+            float_4 rising = gateHigh & ~prevGateHigh[g];
+            prevGateHigh[g] = gateHigh;
+            if (simd::movemask(rising) != 0) startVoices(c, rising, capacity);
+            // Slots above capacity still play out after the menu lowers it
+            int busy = busySlots[g];
+            visitedSlots[g] = busy;
+            for (int slots = busy; slots != 0; slots &= slots - 1) {
+                int v = __builtin_ctz(slots);
+                float_4& t = voicePhase[v][g];
+                float_4 running = voiceRunning[v][g];
+                t = simd::ifelse(running, t + args.sampleTime, t);
+                running = running & ~(t >= shape.totalDuration);
+                voiceRunning[v][g] = running;
+                int lanes = simd::movemask(running);
+                voiceLanes[v][g] = lanes;
+                // A finished voice is 0 V without evaluating it
+                if (lanes == 0) busy &= ~(1 << v);
+                else if (envelopeNeeded) {
+                    DspKernels::get().envelope(shape, t, voiceEnv[v][g]);
+                    voiceEnv[v][g] = simd::ifelse(running, voiceEnv[v][g], 0.f);
+                    env[g] += voiceEnv[v][g];
+                    continue;
+                }
+                voiceEnv[v][g] = 0.f;
+            }
+            busySlots[g] = busy;
+        } else { // Free-running Mode Logic
+            prevGateHigh[g] = 0.f;
+            // Unpatching the clock silences its voices
+            for (int slots = busySlots[g]; slots != 0; slots &= slots - 1) voiceRunning[__builtin_ctz(slots)][g] = 0.f;
+            busySlots[g] = 0;
+            phase[g] += args.sampleTime;
+            float_4 wrapped = simd::fmax(phase[g] - shape.totalDuration, 0.f);
+            phase[g] = simd::ifelse(phase[g] >= shape.totalDuration, wrapped, phase[g]);
+            if (envelopeNeeded) DspKernels::get().envelope(shape, phase[g], env[g]);
+        }
+        envelopeOpen[g] = simd::movemask(env[g] > 0.f) != 0;
+        // Overlapping voices can sum past the envelope's own peak
+        outputs[ENV_OUTPUT].setVoltageSimd(simd::fmin(env[g], 10.f), c);
+    }
+    // --- End Envelope Calculation ---
+    TERROIR_PROFILE_LAP(profiler, ENVELOPE_STAGE);
+
+    // --- Sample Switch: dip through silence, so a switch never clicks ---
+    float switchStep = args.sampleTime / SAMPLE_SWITCH_SECONDS;
+    if (sampleSwitching) {
+        sampleGain -= switchStep;
+        if (sampleGain <= 0.f) {
+            sampleGain = 0.f;
+            switchSamples();
+        }
+    }
+    else if (sampleGain < 1.f) { sampleGain = std::min(sampleGain + switchStep, 1.f); }
+
+    // --- Sample Source: a loaded user sample overrides the bundled selection ---
+    const ThrumSampleSet* set = samples.getCurrent();
+    const SampleData* residentSample = nullptr;
+    SampleStreamer* stream = nullptr;
+    if (!audioInputConnected && set) {
+        if (set->userActive) {
+            if (set->stream) stream = set->stream.get();
+            else if (set->user && set->user->isPlayable()) residentSample = set->user.get();
+        }
+        else if (currentSampleIndex >= 0) {
+            const SampleData* currentSample = set->bundled[currentSampleIndex].get();
+            if (currentSample->isPlayable()) residentSample = currentSample;
+        }
+    }
+
+    // --- Sample Playback ---
+    // Without a PITCH cable every channel shares one playhead at the sample's
+    // own rate; with one, each channel plays from its own playhead below, or
+    // with overlapping hits, each voice from its own.
+    bool pitchConnected = inputs[PITCH_INPUT].isConnected();
+    bool anyOpen = false;
+    for (int g = 0; g < 4; ++g) anyOpen = anyOpen || envelopeOpen[g];
+    bool voiced = audioOutputConnected && anyOpen;
+    float sharedSampleValue = 0.f;
+    if (stream) {
+        float pitch = pitchConnected ? clamp(inputs[PITCH_INPUT].getVoltage(0), PITCH_MIN_OCTAVES, STREAM_MAX_OCTAVES) : 0.f;
+        float rate = stream->getNativeRate() * args.sampleTime * dsp::exp2_taylor5(pitch);
+        if (voiced) sharedSampleValue = playStream(*stream, rate);
+        else advanceStream(*stream, rate);
+    }
+    else if (residentSample && !pitchConnected) {
+        if (pitchWasConnected) playIndex = (size_t)playPosition[0];
+        if (voiced) sharedSampleValue = playResident(*residentSample);
+        else if (++playIndex >= residentSample->length) playIndex = 0;
+    }
+    // Channel playheads pick up from the shared one when PITCH is patched
+    if (residentSample && pitchConnected && !pitchWasConnected)
+        std::fill(playPosition, playPosition + 16, (double)playIndex);
+    pitchWasConnected = pitchConnected;
+    float baseRate = residentSample ? residentSample->nativeRate * args.sampleTime : 0.f;
+    bool pooled = clocked && capacity > 1;
+
+    for (int c = 0; c < channels; c += 4) {
+        int g = c / 4;
+        bool groupVoiced = audioOutputConnected && envelopeOpen[g];
+
+        float_4 sampleValue = sharedSampleValue;
+        float_4 voiceMix = 0.f; // Each voice's sample through its own envelope, summed
+        bool mixed = false;
+        if (residentSample && pitchConnected) {
+            float_4 pitch = simd::clamp(inputs[PITCH_INPUT].getPolyVoltageSimd<float_4>(c), PITCH_MIN_OCTAVES, PITCH_MAX_OCTAVES);
+            float_4 rate = baseRate * dsp::exp2_taylor5(pitch);
+            int lanes = (1 << std::min(4, channels - c)) - 1;
+            if (pooled) {
+                // The channel playhead runs on for the next voice to start
+                // from; each voice reads its own at the pitch it started with
+                advanceResident(*residentSample, playPosition + c, rate, lanes);
+                for (int slots = visitedSlots[g]; slots != 0; slots &= slots - 1) {
+                    int v = __builtin_ctz(slots);
+                    int live = voiceLanes[v][g] & lanes;
+                    if (live == 0) continue;
+                    float_4 voiceRate = baseRate * dsp::exp2_taylor5(voicePitch[v][g]);
+                    int open = groupVoiced ? simd::movemask(voiceEnv[v][g] > 0.f) & live : 0;
+                    if (open != 0) voiceMix += playResident(*residentSample, voicePosition[v] + c, voiceRate, open) * voiceEnv[v][g];
+                    if ((live & ~open) != 0) advanceResident(*residentSample, voicePosition[v] + c, voiceRate, live & ~open);
+                }
+                mixed = true;
+            }
+            else if (groupVoiced) sampleValue = playResident(*residentSample, playPosition + c, rate, lanes);
+            else advanceResident(*residentSample, playPosition + c, rate, lanes);
+        }
+
+        // --- Audio Output Logic: per-channel VCA ---
+        float_4 audioOutputValue = 0.f;
+        if (groupVoiced) {
+            // Overlapping voices are limited to 10 V together, as on ENV, so the gain never passes 1
+            float_4 vca = simd::fmin(env[g], 10.f) / 10.f;
+            if (audioInputConnected) { audioOutputValue = inputs[AUDIO_INPUT].getPolyVoltageSimd<float_4>(c) * vca; }
+            else {
+                if (mixed) { audioOutputValue = (voiceMix * 5.0f) / 10.0f * simd::ifelse(env[g] > 10.f, 10.f / env[g], 1.f); }
+                else { audioOutputValue = (sampleValue * 5.0f) * vca; }
+                if (sampleGain < 1.f) audioOutputValue *= sampleGain;
+            }
+        }
+        outputs[AUDIO_OUTPUT].setVoltageSimd(audioOutputValue, c);
+    }
+    // --- End Sample Playback ---
+    outputs[ENV_OUTPUT].setChannels(channels);
+    outputs[AUDIO_OUTPUT].setChannels(channels);
+    TERROIR_PROFILE_LAP(profiler, PLAYBACK_STAGE);
+    TERROIR_PROFILE_END(profiler, args.sampleTime, reportProfile());
+}
+
+#ifdef TERROIR_PROFILE
+// Resident: the module and its stream buffers. Shared: the pooled samples
+// the playing set holds (other Thrums at the same rate and format use the
+// same ones) and the interpolator table.
+void Thrum::reportProfile() {
+    size_t residentBytes = sizeof(Thrum);
+    size_t sharedBytes = sizeof(PolyphaseKernel);
+    if (const ThrumSampleSet* set = samples.getCurrent()) {
+        for (const SampleHandle& sample : set->bundled)
+            if (sample) sharedBytes += sample->getResidentBytes();
+        if (set->user) sharedBytes += set->user->getResidentBytes();
+        if (set->stream) residentBytes += set->stream->getResidentBytes();
+    }
+    profiler.report(id, residentBytes, sharedBytes);
+}
+#endif
+
+
+#ifndef TERROIR_HEADLESS
+// --- ThrumWidget Constructor ---
+ThrumWidget::ThrumWidget(Thrum* module) {
+    setModule(module);
+    setPanel(createPanel(asset::plugin(pluginInstance, "res/Thrum.svg")));
+
+    // --- Add Controls Row by Row with User's Hardcoded Positions ---
+    // Tooltips are now handled by configInput/configOutput/configParam/configSwitch
+
+    // Duration Row (Y ~ 20-25)
+    addParam(createParamCentered<Magpie125>(mm2px(Vec(9.f, 20.f)), module, Thrum::TOTAL_DURATION_PARAM));
+    addParam(createParamCentered<Song60>(mm2px(Vec(23.f, 22.25f)), module, Thrum::DURATION_ATTEN_PARAM));
+    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34.f, 22.33f)), module, Thrum::DURATION_CV_INPUT));
+
+    // Duty Cycle Row (Y ~ 45-50)
+    addParam(createParamCentered<Magpie125>(mm2px(Vec(9.f, 39.f)), module, Thrum::DUTY_CYCLE_PARAM));
+    addParam(createParamCentered<Song60>(mm2px(Vec(23.f, 41.25f)), module, Thrum::DUTY_ATTEN_PARAM));
+    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34.f, 41.33f)), module, Thrum::DUTY_CV_INPUT));
+
+    // Bias Row (Y ~ 70-75)
+    addParam(createParamCentered<Magpie125>(mm2px(Vec(9.f, 58.f)), module, Thrum::BIAS_PARAM));
+    addParam(createParamCentered<Song60>(mm2px(Vec(23.f, 60.25f)), module, Thrum::BIAS_ATTEN_PARAM));
+    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(34.f, 60.33f)), module, Thrum::BIAS_CV_INPUT));
+
+    // Sample Select Knob (Y ~ 95)
+    addParam(createParamCentered<Song60>(mm2px(Vec(24.f, 92.5f)), module, Thrum::SAMPLE_SELECT_PARAM));
+
+    // Bottom Row Jacks (User's Positions)
+    addInput (createInputCentered<PJ301MPort>(mm2px(Vec(9.f, 80.f)), module, Thrum::CLOCK_INPUT));
+    addInput (createInputCentered<PJ301MPort>(mm2px(Vec(9.f, 92.5f)), module, Thrum::PITCH_INPUT));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(31.f, 105.f)), module, Thrum::AUDIO_OUTPUT));
+    addInput (createInputCentered<PJ301MPort>(mm2px(Vec(9.f, 105.f)), module, Thrum::AUDIO_INPUT));
+    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(31.f, 80.f)), module, Thrum::ENV_OUTPUT));
+
+    // Screws
+    addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+    addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+}
+
+void ThrumWidget::step() {
+    ModuleWidget::step();
+    Thrum* module = getModule<Thrum>();
+    if (module) module->reclaimSamples();
+}
+
+void ThrumWidget::appendContextMenu(Menu* menu) {
+    Thrum* module = getModule<Thrum>();
+    if (!module) return;
+
+    std::string currentPath;
+    {
+        std::lock_guard<std::mutex> lock(module->userSampleMutex);
+        currentPath = module->userSamplePath;
+    }
+
+    menu->addChild(new MenuSeparator);
+    menu->addChild(createMenuLabel("User sample: " + (currentPath.empty() ? std::string("none") : system::getFilename(currentPath))));
+    menu->addChild(createMenuItem("Load sample...", "", [=]() {
+        std::string dir = currentPath.empty() ? asset::user("") : system::getDirectory(currentPath);
+        osdialog_filters* filters = osdialog_filters_parse("WAV:wav");
+        char* pathC = osdialog_file(OSDIALOG_OPEN, dir.c_str(), NULL, filters);
+        osdialog_filters_free(filters);
+        if (!pathC) return;
+        std::string path = pathC;
+        std::free(pathC);
+        module->loadUserSample(path);
+    }));
+    menu->addChild(createMenuItem("Clear user sample", "", [=]() {
+        module->clearUserSample();
+    }, currentPath.empty()));
+    menu->addChild(createBoolMenuItem("Compact sample memory (16-bit)", "",
+        [=]() { return module->compactSamples.load(); },
+        [=](bool compact) { module->setCompactSamples(compact); }
+    ));
+
+    static const int voiceCounts[] = {1, 2, 4, 8};
+    menu->addChild(createIndexSubmenuItem("Overlapping hits", {"Off", "2 voices", "4 voices", "8 voices"},
+        [=]() {
+            int count = module->voiceCount.load();
+            size_t index = 0;
+            while (index < 3 && voiceCounts[index] < count) ++index;
+            return index;
+        },
+        [=](size_t index) {
+            module->voiceCount = voiceCounts[index];
+        }
+    ));
+
+    menu->addChild(new MenuSeparator);
+    appendControlRateMenu(menu, &module->controlRate);
+}
+#endif // TERROIR_HEADLESS
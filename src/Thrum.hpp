@@ -1,77 +1,180 @@
-#ifndef THRUM_HPP
-#define THRUM_HPP
-
-#include "rack.hpp"
-#include "plugin.hpp"
-#include <vector>
-#include <string> // Include string
-
-using namespace rack;
-
-extern rack::Plugin* pluginInstance;
-
-// SampleData struct remains the same
-struct SampleData {
-    std::vector<float> buffer;
-    float nativeRate = 44100.f;
-};
-
-
-struct Thrum : Module {
-    // Updated Enums: Added Duration & Duty CV/Atten Params/Inputs
-    enum ParamIds {
-        // Main Controls
-        TOTAL_DURATION_PARAM, // 0
-        DUTY_CYCLE_PARAM,     // 1
-        BIAS_PARAM,           // 2
-        SAMPLE_SELECT_PARAM,  // 3
-        // Attenuverters for CV Inputs
-        DURATION_ATTEN_PARAM, // 4 (New)
-        DUTY_ATTEN_PARAM,     // 5 (New)
-        BIAS_ATTEN_PARAM,     // 6
-        // --- End New Params ---
-        NUM_PARAMS            // NUM_PARAMS should be last (Value is now 7)
-    };
-    enum InputIds {
-        CLOCK_INPUT,          // 0
-        AUDIO_INPUT,          // 1
-        // CV Inputs for Main Controls
-        DURATION_CV_INPUT,    // 2 (New)
-        DUTY_CV_INPUT,        // 3 (New)
-        BIAS_CV_INPUT,        // 4
-        // --- End New Inputs ---
-        NUM_INPUTS            // NUM_INPUTS should be last (Value is now 5)
-    };
-    enum OutputIds {
-        AUDIO_OUTPUT,         // 0
-        ENV_OUTPUT,           // 1
-        NUM_OUTPUTS           // NUM_OUTPUTS should be last (Value is 2)
-    };
-    enum LightIds {
-        NUM_LIGHTS            // NUM_LIGHTS should be last (Value is 0)
-    };
-
-    // State variables remain the same
-    float clockPhase = 0.f;
-    bool prevGateHigh = false;
-    bool isRunning = false;
-    float phase = 0.f;
-    std::vector<SampleData> loadedSamples;
-    double samplePlaybackPhase = 0.0;
-    int currentSampleIndex = 0;
-    int processCounter = 0;
-
-    // --- Methods ---
-    Thrum(); // Constructor
-    void process(const ProcessArgs& args) override; // Main processing function
-    void onReset() override; // Reset method
-    bool loadSample(const std::string& path, SampleData& outData); // Sample loading helper
-
-};
-
-// Widget declaration
-struct ThrumWidget : rack::app::ModuleWidget {
-    ThrumWidget(Thrum* module);
-};
-
-#endif // THRUM_HPP
+#ifndef THRUM_HPP
+#define THRUM_HPP
+
+#include "rack.hpp"
+#include "plugin.hpp"
+#include "dsp/Envelope.hpp"
+#include "dsp/Interpolator.hpp"
+#include "dsp/Kernels.hpp"
+#include "SamplePool.hpp"
+#include "SampleStreamer.hpp"
+#include "SampleSlot.hpp"
+#include "ControlRate.hpp"
+#include "Profiler.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+using namespace rack;
+
+extern rack::Plugin* pluginInstance;
+
+// Everything the audio thread plays from, handed over as one through
+// Thrum::samples. Immutable once published, apart from the stream's ring.
+struct ThrumSampleSet {
+    std::vector<SampleHandle> bundled; // Indexed by SAMPLE_SELECT_PARAM
+    bool userActive = false; // A user sample replaces the bundled ones, silent while it can't play
+    SampleHandle user;
+    std::unique_ptr<SampleStreamer> stream;
+
+    // Loads still running keep the set from being swapped in
+    bool isReady() const {
+        for (const SampleHandle& sample : bundled)
+            if (!sample || !sample->isReady()) return false;
+        return !user || user->isReady();
+    }
+};
+
+static const int THRUM_MAX_VOICES = 8; // Overlapping envelopes per channel in clocked mode
+
+struct Thrum : Module {
+    enum ParamIds {
+        // Main Controls
+        TOTAL_DURATION_PARAM, // 0
+        DUTY_CYCLE_PARAM,     // 1
+        BIAS_PARAM,           // 2
+        SAMPLE_SELECT_PARAM,  // 3
+        // Attenuverters for CV Inputs
+        DURATION_ATTEN_PARAM, // 4
+        DUTY_ATTEN_PARAM,     // 5
+        BIAS_ATTEN_PARAM,     // 6
+        NUM_PARAMS            // NUM_PARAMS should be last (Value is 7)
+    };
+    enum InputIds {
+        CLOCK_INPUT,          // 0
+        AUDIO_INPUT,          // 1
+        // CV Inputs for Main Controls
+        DURATION_CV_INPUT,    // 2
+        DUTY_CV_INPUT,        // 3
+        BIAS_CV_INPUT,        // 4
+        PITCH_INPUT,          // 5 (V/Oct for sample playback)
+        NUM_INPUTS            // NUM_INPUTS should be last (Value is 6)
+    };
+    enum OutputIds {
+        AUDIO_OUTPUT,         // 0
+        ENV_OUTPUT,           // 1
+        NUM_OUTPUTS           // NUM_OUTPUTS should be last (Value is 2)
+    };
+    enum LightIds {
+        NUM_LIGHTS            // NUM_LIGHTS should be last (Value is 0)
+    };
+    // process() stages timed in TERROIR_PROFILE builds
+    enum ProfileStages {
+        MAPPING_STAGE,
+        ENVELOPE_STAGE,
+        PLAYBACK_STAGE,
+        NUM_STAGES
+    };
+
+    // Per-channel envelope state, structure-of-arrays in float_4 lanes
+    // (voiceRunning/prevGateHigh hold SIMD lane masks)
+    simd::float_4 prevGateHigh[4] = {};
+    simd::float_4 phase[4] = {};
+    // Clocked voice pool, slot-major: voicePhase[v][g] is slot v of the four
+    // channels in group g. Each clock edge starts a voice in its channel's
+    // next slot, so hits overlap instead of cutting each other off. All of it
+    // is fixed-size; voiceCount only limits how many slots a channel uses.
+    simd::float_4 voicePhase[THRUM_MAX_VOICES][4] = {};
+    simd::float_4 voiceRunning[THRUM_MAX_VOICES][4] = {};
+    simd::float_4 voicePitch[THRUM_MAX_VOICES][4] = {}; // PITCH when the voice started, in octaves
+    double voicePosition[THRUM_MAX_VOICES][16] = {}; // Voice playheads in level-0 frames
+    int busySlots[4] = {}; // Per group, bit v set while slot v has a running lane
+    std::atomic<int> voiceCount{1}; // Slots per channel (menu option, saved with the patch); 1 cuts the last hit off
+    EnvelopeShape4 envelopeShape[4]; // Updated from params and CV once per control block
+    ControlRate controlRate;
+    int channels = 1;
+    std::vector<std::string> samplePaths;
+
+    // --- Sample Handoff ---
+    // The UI thread owns the selection below (guarded by userSampleMutex,
+    // which the audio thread never takes) and publishes each change as a new
+    // ThrumSampleSet. Once every load in it is ready, the audio thread fades
+    // the sample out over SAMPLE_SWITCH_SECONDS, swaps the set in at silence
+    // and fades back in; a new SAMPLE selection switches the same way. The
+    // replaced set is deleted by reclaimSamples() on the UI thread.
+    SampleSlot<ThrumSampleSet> samples;
+    std::vector<SampleHandle> loadedSamples; // Bundled samples at engineSampleRate, from SamplePool
+    // Resident samples are stored as 16-bit frames when set (menu option,
+    // saved with the patch)
+    std::atomic<bool> compactSamples{false};
+    std::atomic<bool> samplesAcquired{false}; // Set by the first onSampleRateChange
+    std::atomic<float> engineSampleRate{44100.f}; // Written in onSampleRateChange, read by UI-thread loads
+    // Audio thread
+    double playPosition[16] = {}; // Per-channel playhead in level-0 frames
+    size_t playIndex = 0; // Shared playhead while PITCH is unpatched
+    bool pitchWasConnected = false; // Which of the two playheads is current
+    int currentSampleIndex = 0;
+    int nextSampleIndex = 0; // SAMPLE selection waiting for the switch
+    bool sampleSwitching = false; // Fading out towards a switch
+    float sampleGain = 1.f;
+#ifdef TERROIR_PROFILE
+    StageProfiler profiler{"Thrum", {"mapping", "envelope", "playback"}};
+    void reportProfile(); // Audio thread
+#endif
+
+    // User sample (chosen from the context menu) overrides the bundled
+    // selection. Short files load through SamplePool; long ones stream from
+    // disk, with each published set opening its own stream. A resident user
+    // sample is also saved in the patch storage directory (see onSave()),
+    // and patches restore it from there.
+    std::string userSamplePath;
+    SampleHandle userSample;
+    bool userStreamed = false;
+    std::string snapshotName; // File in patch storage holding snapshotSample, if any
+    std::weak_ptr<const SampleData> snapshotSample;
+    std::mutex userSampleMutex;
+    // Audio thread
+    float streamHistory[2 * INTERP_TAPS] = {}; // Last INTERP_TAPS frames, written twice so a window is always contiguous
+    int streamWrite = 0;
+    double streamFrac = 0.0;
+
+    // --- Methods ---
+    Thrum(); // Constructor
+    void process(const ProcessArgs& args) override; // Main processing function
+    void onReset() override; // Reset method
+    void onSampleRateChange(const SampleRateChangeEvent& e) override;
+    void onSave(const SaveEvent& e) override;
+    json_t* dataToJson() override;
+    void dataFromJson(json_t* rootJ) override;
+    void loadUserSample(const std::string& path, SampleHandle snapshot = nullptr); // UI thread
+    SampleHandle openUserSampleSnapshot(const std::string& name); // UI thread
+    bool isUserSampleCurrent(float sampleRate, SampleFormat format); // userSampleMutex held
+    void clearUserSample(); // UI thread
+    void setCompactSamples(bool compact); // UI thread
+    void publishSamples(); // userSampleMutex held
+    void reclaimSamples() { samples.reclaim(); } // UI thread
+    SampleFormat getSampleFormat() const { return compactSamples ? SAMPLE_INT16 : SAMPLE_FLOAT32; }
+    void updateControls(); // Audio thread, start of each control block
+    void resetPlayback();
+    void switchSamples(); // Audio thread
+    void startVoices(int c, simd::float_4 rising, int capacity); // Audio thread
+    float playResident(const SampleData& sample); // Audio thread
+    simd::float_4 playResident(const SampleData& sample, double* position, simd::float_4 rate, int lanes); // Audio thread
+    void advanceResident(const SampleData& sample, double* position, simd::float_4 rate, int lanes); // Audio thread
+    float playStream(SampleStreamer& stream, float rate); // Audio thread
+    void advanceStream(SampleStreamer& stream, float rate); // Audio thread
+
+};
+
+// Widget declaration
+#ifndef TERROIR_HEADLESS
+struct ThrumWidget : rack::app::ModuleWidget {
+    ThrumWidget(Thrum* module);
+    void step() override;
+    void appendContextMenu(Menu* menu) override;
+};
+#endif
+
+#endif // THRUM_HPP
@@ -1,37 +1,163 @@
-#include "Wend.hpp"
-extern rack::Plugin* pluginInstance;
-#include "componentlibrary.hpp"
-#include "widgets/Magpie125.hpp"
-#include "widgets/Song60.hpp"
-
-extern Plugin* pluginInstance;
-
-WendWidget::WendWidget(Wend* module) {
-    setModule(module);
-    setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Wend.svg")));
-
-    // Screws
-    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
-    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
-    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-
-    // Frequency knob
-    addParam(createParamCentered<Magpie125>(
-        Vec(30.f, 60.f), module, Wend::FREQ_PARAM));
-
-    // Audio output
-    addOutput(createOutputCentered<PJ301MPort>(
-        Vec(30.f, 120.f), module, Wend::AUDIO_OUTPUT));
-}
-
-void Wend::process(const ProcessArgs& args) {
-    float freqMult = params[FREQ_PARAM].getValue();
-    phase += freqMult * args.sampleTime * 2.f * M_PI;
-    if (phase > 2.f * M_PI)
-        phase -= 2.f * M_PI;
-
-    float signal = sinf(phase);
-    outputs[AUDIO_OUTPUT].setVoltage(5.f * signal);
-}
-
+#include "Wend.hpp"
+extern rack::Plugin* pluginInstance;
+#ifndef TERROIR_HEADLESS
+#include "componentlibrary.hpp"
+#include "widgets/Magpie125.hpp"
+#include "widgets/Song60.hpp"
+#endif
+
+extern Plugin* pluginInstance;
+
+#ifndef TERROIR_HEADLESS
+WendWidget::WendWidget(Wend* module) {
+    setModule(module);
+    setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Wend.svg")));
+
+    // Screws
+    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+    // Frequency knob
+    addParam(createParamCentered<Magpie125>(
+        Vec(30.f, 60.f), module, Wend::FREQ_PARAM));
+
+    // Shape knob
+    addParam(createParamCentered<Song60>(
+        Vec(90.f, 60.f), module, Wend::SHAPE_PARAM));
+
+    // Drive knob
+    addParam(createParamCentered<Song60>(
+        Vec(90.f, 90.f), module, Wend::DRIVE_PARAM));
+
+    // FM amount
+    addParam(createParamCentered<Song60>(
+        Vec(90.f, 130.f), module, Wend::FM_PARAM));
+
+    // Audio output
+    addOutput(createOutputCentered<PJ301MPort>(
+        Vec(30.f, 120.f), module, Wend::AUDIO_OUTPUT));
+
+    // Pitch and FM inputs
+    addInput(createInputCentered<PJ301MPort>(
+        Vec(30.f, 180.f), module, Wend::VOCT_INPUT));
+    addInput(createInputCentered<PJ301MPort>(
+        Vec(90.f, 180.f), module, Wend::FM_INPUT));
+}
+#endif
+
+void Wend::updateControls() {
+    // One voice per V/Oct channel; FM follows it, mono FM is shared
+    channels = std::max(1, inputs[VOCT_INPUT].getChannels());
+    freqMult = params[FREQ_PARAM].getValue();
+    int block = controlRate.blockLength;
+    shapeSmoother.setTarget(params[SHAPE_PARAM].getValue(), block);
+    // Linear FM, 5 V swings the frequency by 100% of the amount
+    fmScaleSmoother.setTarget(0.2f * params[FM_PARAM].getValue(), block);
+    // Drive sweeps the clipper's input gain from 0.25 (nearly linear) to 10
+    gainSmoother.setTarget(0.25f * std::pow(40.f, params[DRIVE_PARAM].getValue()), block);
+    if (!gainSmoother.isRamping()) shaper.setGain(gainSmoother.value);
+}
+
+void Wend::process(const ProcessArgs& args) {
+    TERROIR_PROFILE_START(profiler);
+    if (controlRate.tick()) updateControls();
+    bool fmConnected = inputs[FM_INPUT].isConnected();
+    float shape = shapeSmoother.process();
+    float fmScale = fmScaleSmoother.process();
+    if (gainSmoother.isRamping()) shaper.setGain(gainSmoother.process());
+    int factor = oversampleFactor.load(std::memory_order_relaxed);
+    TERROIR_PROFILE_LAP(profiler, MAPPING_STAGE);
+
+    // With the output unpatched only the phases advance, so voices stay in
+    // tune with each other; the oversampler restarts clean on reconnection
+    bool outputConnected = outputs[AUDIO_OUTPUT].isConnected();
+    if (outputConnected && idle) {
+        for (int g = 0; g < 4; ++g) oversampler[g].reset();
+    }
+    idle = !outputConnected;
+
+    const WendWavetable& wavetable = WendWavetable::get();
+    const DspKernels& kernels = DspKernels::get();
+    for (int c = 0; c < channels; c += 4) {
+        int g = c / 4;
+        simd::float_4 pitch = inputs[VOCT_INPUT].getPolyVoltageSimd<simd::float_4>(c);
+        simd::float_4 freq = freqMult * dsp::exp2_taylor5(simd::clamp(pitch, -10.f, 10.f));
+        // Linear FM; it may go through zero
+        if (fmConnected) freq += freq * (inputs[FM_INPUT].getPolyVoltageSimd<simd::float_4>(c) * fmScale);
+        simd::float_4 increment = simd::clamp(freq * args.sampleTime, -0.5f, 0.5f);
+        phase[g] += increment;
+        phase[g] -= simd::floor(phase[g]);
+        if (idle) continue;
+
+        // The octave table follows each voice's increment, so shaped output stays band-limited
+        simd::float_4 signal;
+        kernels.wavetable(wavetable, phase[g], increment, shape, signal);
+        TERROIR_PROFILE_LAP(profiler, OSCILLATOR_STAGE);
+        oversampler[g].setFactor(factor);
+        signal = oversampler[g].process(signal, shaper);
+        outputs[AUDIO_OUTPUT].setVoltageSimd(5.f * signal, c);
+        TERROIR_PROFILE_LAP(profiler, SHAPER_STAGE);
+    }
+    outputs[AUDIO_OUTPUT].setChannels(channels);
+    TERROIR_PROFILE_LAP(profiler, OSCILLATOR_STAGE); // Idle phase advance
+    TERROIR_PROFILE_END(profiler, args.sampleTime, reportProfile());
+}
+
+#ifdef TERROIR_PROFILE
+// The wavetable is built once and shared by every Wend
+void Wend::reportProfile() {
+    profiler.report(id, sizeof(Wend), sizeof(WendWavetable));
+}
+#endif
+
+void Wend::onReset() {
+    for (int g = 0; g < 4; ++g) {
+        phase[g] = 0.f;
+        oversampler[g].reset();
+    }
+    controlRate.invalidate();
+}
+
+json_t* Wend::dataToJson() {
+    json_t* rootJ = json_object();
+    json_object_set_new(rootJ, "oversample", json_integer(oversampleFactor.load()));
+    controlRate.dataToJson(rootJ);
+    return rootJ;
+}
+
+void Wend::dataFromJson(json_t* rootJ) {
+    json_t* oversampleJ = json_object_get(rootJ, "oversample");
+    if (oversampleJ) oversampleFactor = snapOversampleFactor((int)json_integer_value(oversampleJ));
+    controlRate.dataFromJson(rootJ);
+}
+
+// The smallest menu choice at or above `factor`, so a value the menu can't
+// show is never loaded (or saved back)
+int Wend::snapOversampleFactor(int factor) {
+    int index = 0;
+    while (index < WEND_OVERSAMPLE_FACTOR_COUNT - 1 && WEND_OVERSAMPLE_FACTORS[index] < factor) ++index;
+    return WEND_OVERSAMPLE_FACTORS[index];
+}
+
+#ifndef TERROIR_HEADLESS
+void WendWidget::appendContextMenu(Menu* menu) {
+    Wend* module = getModule<Wend>();
+    if (!module) return;
+
+    menu->addChild(new MenuSeparator);
+    menu->addChild(createIndexSubmenuItem("Oversampling", {"Off", "2x", "4x", "8x"},
+        [=]() {
+            int factor = module->oversampleFactor.load();
+            size_t index = 0;
+            while (index < WEND_OVERSAMPLE_FACTOR_COUNT - 1 && WEND_OVERSAMPLE_FACTORS[index] < factor) ++index;
+            return index;
+        },
+        [=](size_t index) {
+            module->oversampleFactor = WEND_OVERSAMPLE_FACTORS[index];
+        }
+    ));
+    appendControlRateMenu(menu, &module->controlRate);
+}
+#endif
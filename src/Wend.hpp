@@ -1,36 +1,94 @@
-#pragma once
-#include <rack.hpp>
-
-using namespace rack;
-
-struct Wend : engine::Module {
-    enum ParamIds {
-        FREQ_PARAM,
-        NUM_PARAMS
-    };
-    enum InputIds {
-        NUM_INPUTS
-    };
-    enum OutputIds {
-        AUDIO_OUTPUT,
-        NUM_OUTPUTS
-    };
-    enum LightIds {
-        NUM_LIGHTS
-    };
-
-    float phase = 0.f;
-
-    Wend() {
-        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-        configParam(FREQ_PARAM, 20.f, 20000.f, 1.f, "Frequency Multiplier");
-    }
-
-    void process(const ProcessArgs& args) override;
-};
-
-struct WendWidget : app::ModuleWidget {
-    WendWidget(Wend* module);
-};
-
-extern Model* modelWend;
+#pragma once
+#include <rack.hpp>
+#include "dsp/Wavetable.hpp"
+#include "dsp/Oversampler.hpp"
+#include "dsp/Kernels.hpp"
+#include "ControlRate.hpp"
+#include "Profiler.hpp"
+#include <atomic>
+
+using namespace rack;
+
+// Oversampling menu choices (Off, 2x, 4x, 8x)
+static const int WEND_OVERSAMPLE_FACTORS[] = {1, 2, 4, 8};
+static const int WEND_OVERSAMPLE_FACTOR_COUNT = 4;
+
+struct Wend : engine::Module {
+    enum ParamIds {
+        FREQ_PARAM,
+        SHAPE_PARAM,
+        DRIVE_PARAM,
+        FM_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        VOCT_INPUT,
+        FM_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        AUDIO_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+    // process() stages timed in TERROIR_PROFILE builds
+    enum ProfileStages {
+        MAPPING_STAGE,
+        OSCILLATOR_STAGE,
+        SHAPER_STAGE,
+        NUM_STAGES
+    };
+
+    // Per-voice phase in cycles, [0, 1), four voices per float_4
+    simd::float_4 phase[4] = {};
+    int channels = 1;
+    bool idle = false; // Output unpatched: phases only
+
+    // Soft-clip stage, run at oversampleFactor times the engine rate so its
+    // harmonics don't fold back. The factor is set from the context menu;
+    // off by default, so a Wend that isn't driven hard doesn't pay for it.
+    HalfbandOversampler<simd::float_4> oversampler[4];
+    SoftClipShaper shaper;
+    std::atomic<int> oversampleFactor{1};
+
+    // Knob values, mapped once per control block and ramped across it
+    ControlRate controlRate;
+    float freqMult = 1.f;
+    ControlSmoother shapeSmoother;
+    ControlSmoother fmScaleSmoother; // Linear FM depth per volt
+    ControlSmoother gainSmoother;    // Soft-clip input gain
+
+#ifdef TERROIR_PROFILE
+    StageProfiler profiler{"Wend", {"mapping", "oscillator", "shaper"}};
+    void reportProfile();
+#endif
+
+    Wend() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(FREQ_PARAM, 20.f, 20000.f, 1.f, "Frequency Multiplier");
+        configParam(SHAPE_PARAM, 0.f, 1.f, 0.f, "Shape", "%", 0.f, 100.f);
+        configParam(DRIVE_PARAM, 0.f, 1.f, 0.f, "Drive", "%", 0.f, 100.f);
+        configParam(FM_PARAM, -1.f, 1.f, 0.f, "Linear FM amount", "%", 0.f, 100.f);
+        configInput(VOCT_INPUT, "1V/octave pitch");
+        configInput(FM_INPUT, "Linear FM");
+        WendWavetable::get(); // Build the tables here rather than on the first audio sample
+    }
+
+    void process(const ProcessArgs& args) override;
+    void updateControls();
+    void onReset() override;
+    json_t* dataToJson() override;
+    void dataFromJson(json_t* rootJ) override;
+    static int snapOversampleFactor(int factor);
+};
+
+#ifndef TERROIR_HEADLESS
+struct WendWidget : app::ModuleWidget {
+    WendWidget(Wend* module);
+    void appendContextMenu(Menu* menu) override;
+};
+#endif
+
+extern Model* modelWend;
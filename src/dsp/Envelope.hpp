@@ -0,0 +1,90 @@
+#pragma once
+#include <rack.hpp>
+#include <cmath>
+
+// --- Thrum Envelope Engine ---
+// Attack and decay both follow the normalized exponential segment
+//   g(x) = (e^(-k*x) - e^(-k)) / (1 - e^(-k)),  x in [0, 1]
+// which is tabulated once and linearly interpolated. With 1024 intervals the
+// interpolation error is bounded by h^2/8 * max|g''| ~= 3.0e-6, i.e. under
+// 50 uV on the 10 V envelope (segments shorter than ~1 ms are limited by the
+// float resolution of t itself, as the old std::exp path was). Evaluation is
+// stateless in t, so it stays exact at any cycle time, including audio rate.
+
+constexpr float ENVELOPE_CURVE_K = 5.f;
+constexpr int ENVELOPE_TABLE_SIZE = 1024;
+constexpr float ENVELOPE_MIN_DURATION = 0.05f;
+constexpr float ENVELOPE_MAX_DURATION = 3.0f;
+
+struct EnvelopeCurveTable {
+	// One guard point past x = 1 so the interpolation never reads out of range
+	float values[ENVELOPE_TABLE_SIZE + 2];
+
+	EnvelopeCurveTable() {
+		const float tail = std::exp(-ENVELOPE_CURVE_K);
+		for (int i = 0; i <= ENVELOPE_TABLE_SIZE; ++i) {
+			float x = (float)i / ENVELOPE_TABLE_SIZE;
+			values[i] = (std::exp(-ENVELOPE_CURVE_K * x) - tail) / (1.f - tail);
+		}
+		values[ENVELOPE_TABLE_SIZE + 1] = values[ENVELOPE_TABLE_SIZE];
+	}
+
+	// x must already be clamped to [0, 1]
+	rack::simd::float_4 lookup(rack::simd::float_4 x) const {
+		rack::simd::float_4 pos = x * (float)ENVELOPE_TABLE_SIZE;
+		rack::simd::float_4 y0, y1, frac;
+		for (int i = 0; i < 4; ++i) {
+			int index = (int)pos[i];
+			frac[i] = pos[i] - index;
+			y0[i] = values[index];
+			y1[i] = values[index + 1];
+		}
+		return y0 + (y1 - y0) * frac;
+	}
+
+	static const EnvelopeCurveTable& get() {
+		static const EnvelopeCurveTable table;
+		return table;
+	}
+};
+
+// Segment coefficients for four channels. Inputs are the already clamped
+// 0-1 duration/duty/bias values; the duration curve, peak position and
+// reciprocals are only recomputed when one of them changes.
+struct EnvelopeShape4 {
+	rack::simd::float_4 linearDuration = -1.f; // -1 forces the first update
+	rack::simd::float_4 duty = -1.f;
+	rack::simd::float_4 bias = -1.f;
+
+	rack::simd::float_4 totalDuration = ENVELOPE_MIN_DURATION;
+	rack::simd::float_4 envelopeDuration = ENVELOPE_MIN_DURATION;
+	rack::simd::float_4 peak = 0.f;
+	rack::simd::float_4 invPeak = 0.f;
+	rack::simd::float_4 invDecay = 0.f;
+
+	void update(rack::simd::float_4 newLinearDuration, rack::simd::float_4 newDuty, rack::simd::float_4 newBias) {
+		using rack::simd::float_4;
+		float_4 changed = (newLinearDuration != linearDuration) | (newDuty != duty) | (newBias != bias);
+		if (rack::simd::movemask(changed) == 0)
+			return;
+		linearDuration = newLinearDuration;
+		duty = newDuty;
+		bias = newBias;
+
+		totalDuration = ENVELOPE_MIN_DURATION * rack::simd::pow(ENVELOPE_MAX_DURATION / ENVELOPE_MIN_DURATION, linearDuration);
+		envelopeDuration = rack::simd::fmax(totalDuration * rack::simd::clamp(duty, 0.01f, 0.99f), 1e-6f);
+		peak = envelopeDuration * bias;
+		peak = rack::simd::fmax(1e-6f, rack::simd::fmin(peak, envelopeDuration - 1e-6f));
+		invPeak = 1.f / peak;
+		invDecay = 1.f / rack::simd::fmax(envelopeDuration - peak, 1e-6f);
+	}
+
+	// Envelope in volts (0-10) at time t into the cycle
+	rack::simd::float_4 evaluate(rack::simd::float_4 t) const {
+		using rack::simd::float_4;
+		float_4 x = rack::simd::ifelse(t <= peak, 1.f - t * invPeak, (t - peak) * invDecay);
+		x = rack::simd::clamp(x, 0.f, 1.f);
+		float_4 env = 10.f * EnvelopeCurveTable::get().lookup(x);
+		return rack::simd::ifelse(t <= envelopeDuration, env, 0.f);
+	}
+};
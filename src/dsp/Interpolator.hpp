@@ -0,0 +1,119 @@
+#pragma once
+#include <simd/Vector.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <emmintrin.h>
+#include "Kaiser.hpp"
+
+// --- Polyphase Sinc Interpolator ---
+// Band-limited fractional read for pitched sample playback. The kernel is a
+// Kaiser-windowed sinc, INTERP_TAPS wide, tabulated at INTERP_PHASES
+// fractional offsets and linearly interpolated between adjacent phases. Each
+// read is eight float_4 multiply-adds over contiguous frames, so the caller
+// must keep INTERP_HALF_TAPS - 1 frames readable before the read position and
+// INTERP_HALF_TAPS after it (SamplePool pads every level with wrapped guard
+// frames for this).
+//
+// Reading faster than one frame per output sample would alias, so the table
+// holds INTERP_BANKS cutoffs: bank 0 passes INTERP_PASSBAND of Nyquist for
+// rates up to 1, and bank b > 0 narrows the cutoff for rates up to
+// 1 + b / (INTERP_BANKS - 1). Rates of 2 and above are handled by reading a
+// mip level that was decimated by 2 beforehand, so the residual rate handed
+// to getBank() always lies below 2.
+//
+// 16-bit frames (SAMPLE_INT16) take the same path: each group of eight is
+// loaded at once and widened to two float_4 in registers, so the wider
+// format never exists in memory.
+
+constexpr int INTERP_TAPS = 32;
+constexpr int INTERP_HALF_TAPS = INTERP_TAPS / 2;
+constexpr int INTERP_PHASES = 128;
+constexpr int INTERP_BANKS = 5;
+constexpr double INTERP_KAISER_BETA = 6.0;
+constexpr double INTERP_PASSBAND = 0.88;
+
+struct PolyphaseKernel {
+	// coeffs[bank][phase][tap]; tap t weighs frame (index + t - INTERP_HALF_TAPS + 1).
+	// One extra phase row at frac = 1 so the phase interpolation never reads past the table.
+	alignas(16) float coeffs[INTERP_BANKS][INTERP_PHASES + 1][INTERP_TAPS];
+
+	static const PolyphaseKernel& get() {
+		static const PolyphaseKernel kernel;
+		return kernel;
+	}
+
+	PolyphaseKernel() {
+		double i0Beta = kaiserBesselI0(INTERP_KAISER_BETA);
+		for (int b = 0; b < INTERP_BANKS; ++b) {
+			double maxRate = 1.0 + (double)b / (INTERP_BANKS - 1);
+			double cutoff = INTERP_PASSBAND / maxRate;
+			for (int p = 0; p <= INTERP_PHASES; ++p) {
+				double frac = (double)p / INTERP_PHASES;
+				double sum = 0.0;
+				double row[INTERP_TAPS];
+				for (int t = 0; t < INTERP_TAPS; ++t) {
+					double x = (t - INTERP_HALF_TAPS + 1) - frac;
+					double w = x / INTERP_HALF_TAPS;
+					double window = (std::fabs(w) < 1.0) ? kaiserBesselI0(INTERP_KAISER_BETA * std::sqrt(1.0 - w * w)) / i0Beta : 0.0;
+					double arg = M_PI * cutoff * x;
+					double sinc = (std::fabs(arg) < 1e-12) ? 1.0 : std::sin(arg) / arg;
+					row[t] = cutoff * sinc * window;
+					sum += row[t];
+				}
+				// Unity gain at DC for every phase, so slow sweeps don't flutter
+				for (int t = 0; t < INTERP_TAPS; ++t) coeffs[b][p][t] = (float)(row[t] / sum);
+			}
+		}
+	}
+
+	// Bank for a residual playback rate (frames advanced per output sample, below 2)
+	static int getBank(float rate) {
+		if (rate <= 1.f) return 0;
+		int bank = (int)std::ceil((rate - 1.f) * (INTERP_BANKS - 1));
+		return std::min(bank, INTERP_BANKS - 1);
+	}
+
+	// Value at frames[0] + frac, frac in [0, 1)
+	float interpolate(const float* frames, float frac, int bank) const {
+		using rack::simd::float_4;
+		float x = frac * INTERP_PHASES;
+		int p = std::min((int)x, INTERP_PHASES - 1);
+		float_4 mu = x - p;
+		const float* row0 = coeffs[bank][p];
+		const float* row1 = coeffs[bank][p + 1];
+		const float* src = frames - (INTERP_HALF_TAPS - 1);
+		float_4 sum = 0.f;
+		for (int t = 0; t < INTERP_TAPS; t += 4) {
+			float_4 c0 = float_4::load(row0 + t);
+			float_4 c1 = float_4::load(row1 + t);
+			sum += float_4::load(src + t) * (c0 + (c1 - c0) * mu);
+		}
+		return sum[0] + sum[1] + sum[2] + sum[3];
+	}
+
+	// As above for 16-bit frames, where each step is worth `scale`
+	float interpolate(const int16_t* frames, float frac, int bank, float scale) const {
+		using rack::simd::float_4;
+		float x = frac * INTERP_PHASES;
+		int p = std::min((int)x, INTERP_PHASES - 1);
+		float_4 mu = x - p;
+		const float* row0 = coeffs[bank][p];
+		const float* row1 = coeffs[bank][p + 1];
+		const int16_t* src = frames - (INTERP_HALF_TAPS - 1);
+		float_4 sum = 0.f;
+		for (int t = 0; t < INTERP_TAPS; t += 8) {
+			// Sign-extend by pairing each word with itself and shifting down
+			__m128i packed = _mm_loadu_si128((const __m128i*)(src + t));
+			float_4 lo(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16)));
+			float_4 hi(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16)));
+			float_4 c0 = float_4::load(row0 + t);
+			float_4 c1 = float_4::load(row1 + t);
+			sum += lo * (c0 + (c1 - c0) * mu);
+			c0 = float_4::load(row0 + t + 4);
+			c1 = float_4::load(row1 + t + 4);
+			sum += hi * (c0 + (c1 - c0) * mu);
+		}
+		return (sum[0] + sum[1] + sum[2] + sum[3]) * scale;
+	}
+};
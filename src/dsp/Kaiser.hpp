@@ -0,0 +1,19 @@
+#pragma once
+
+// --- Kaiser Window ---
+// Zeroth-order modified Bessel function of the first kind, by its power
+// series. The window at w in [-1, 1] is
+// kaiserBesselI0(beta * sqrt(1 - w * w)) / kaiserBesselI0(beta). Only used
+// when tabulating kernels, so it favours accuracy over speed.
+
+inline double kaiserBesselI0(double x) {
+	double sum = 1.0;
+	double term = 1.0;
+	double halfX = x / 2.0;
+	for (int k = 1; k < 64; ++k) {
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
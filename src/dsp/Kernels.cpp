@@ -0,0 +1,211 @@
+#include "Kernels.hpp"
+#include "Envelope.hpp"
+#include "Interpolator.hpp"
+#include "Walk.hpp"
+#include "Wavetable.hpp"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define TERROIR_KERNELS_X86 1
+#include <immintrin.h>
+// `flatten` inlines the shared header code into each variant, so it is
+// compiled for that variant's instruction set rather than called at baseline
+#define TERROIR_TARGET_AVX2 __attribute__((target("avx2,fma"), flatten))
+#define TERROIR_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,fma"), flatten))
+#else
+#define TERROIR_KERNELS_X86 0
+#endif
+
+using rack::simd::float_4;
+
+
+// --- sse2: the inline header code ---
+static void envelopeSse2(const EnvelopeShape4& shape, const float_4& t, float_4& env) {
+	env = shape.evaluate(t);
+}
+
+static float interpolateSse2(const PolyphaseKernel& kernel, const float* frames, float frac, int bank) {
+	return kernel.interpolate(frames, frac, bank);
+}
+
+static float interpolateCompactSse2(const PolyphaseKernel& kernel, const int16_t* frames, float frac, int bank, float scale) {
+	return kernel.interpolate(frames, frac, bank, scale);
+}
+
+static void walkForceSse2(const float_4& value, const float_4& bias, const float_4& lower, const float_4& upper, const float_4& pull, float_4& force) {
+	force = walkForce(value, bias, lower, upper, pull);
+}
+
+static void wavetableSse2(const WendWavetable& wavetable, const float_4& phase, const float_4& increment, float shape, float_4& out) {
+	out = wavetable.evaluate(phase, increment, shape);
+}
+
+static const DspKernels SSE2_KERNELS = {
+	"sse2", envelopeSse2, interpolateSse2, interpolateCompactSse2, walkForceSse2, wavetableSse2
+};
+
+const DspKernels* DspKernels::active = &SSE2_KERNELS;
+
+
+#if TERROIR_KERNELS_X86
+// --- avx2 ---
+TERROIR_TARGET_AVX2 static inline float horizontalSum(__m256 v) {
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+
+// As EnvelopeShape4::evaluate(), with the curve table read by two gathers
+TERROIR_TARGET_AVX2 static void envelopeAvx2(const EnvelopeShape4& shape, const float_4& t, float_4& env) {
+	float_4 x = rack::simd::ifelse(t <= shape.peak, 1.f - t * shape.invPeak, (t - shape.peak) * shape.invDecay);
+	x = rack::simd::clamp(x, 0.f, 1.f);
+	float_4 pos = x * (float)ENVELOPE_TABLE_SIZE;
+	__m128i index = _mm_cvttps_epi32(pos.v);
+	float_4 frac = pos - float_4(_mm_cvtepi32_ps(index));
+	const float* values = EnvelopeCurveTable::get().values;
+	float_4 y0(_mm_i32gather_ps(values, index, 4));
+	float_4 y1(_mm_i32gather_ps(values + 1, index, 4));
+	float_4 curve = 10.f * (y0 + (y1 - y0) * frac);
+	env = rack::simd::ifelse(t <= shape.envelopeDuration, curve, 0.f);
+}
+
+// Four 8-wide steps over the 32 taps, blending the two phase rows with FMA
+TERROIR_TARGET_AVX2 static float interpolateAvx2(const PolyphaseKernel& kernel, const float* frames, float frac, int bank) {
+	float x = frac * INTERP_PHASES;
+	int p = std::min((int)x, INTERP_PHASES - 1);
+	__m256 mu = _mm256_set1_ps(x - p);
+	const float* row0 = kernel.coeffs[bank][p];
+	const float* row1 = kernel.coeffs[bank][p + 1];
+	const float* src = frames - (INTERP_HALF_TAPS - 1);
+	__m256 sum = _mm256_setzero_ps();
+	for (int t = 0; t < INTERP_TAPS; t += 8) {
+		__m256 c0 = _mm256_loadu_ps(row0 + t);
+		__m256 c = _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(row1 + t), c0), mu, c0);
+		sum = _mm256_fmadd_ps(_mm256_loadu_ps(src + t), c, sum);
+	}
+	return horizontalSum(sum);
+}
+
+TERROIR_TARGET_AVX2 static float interpolateCompactAvx2(const PolyphaseKernel& kernel, const int16_t* frames, float frac, int bank, float scale) {
+	float x = frac * INTERP_PHASES;
+	int p = std::min((int)x, INTERP_PHASES - 1);
+	__m256 mu = _mm256_set1_ps(x - p);
+	const float* row0 = kernel.coeffs[bank][p];
+	const float* row1 = kernel.coeffs[bank][p + 1];
+	const int16_t* src = frames - (INTERP_HALF_TAPS - 1);
+	__m256 sum = _mm256_setzero_ps();
+	for (int t = 0; t < INTERP_TAPS; t += 8) {
+		__m256 c0 = _mm256_loadu_ps(row0 + t);
+		__m256 c = _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(row1 + t), c0), mu, c0);
+		__m256 s = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + t))));
+		sum = _mm256_fmadd_ps(s, c, sum);
+	}
+	return horizontalSum(sum) * scale;
+}
+
+TERROIR_TARGET_AVX2 static void walkForceAvx2(const float_4& value, const float_4& bias, const float_4& lower, const float_4& upper, const float_4& pull, float_4& force) {
+	force = walkForce(value, bias, lower, upper, pull);
+}
+
+// As WendWavetable::evaluate(), with each lane's octave level computed in
+// vector registers and the four table reads done by gathers
+TERROIR_TARGET_AVX2 static void wavetableAvx2(const WendWavetable& wavetable, const float_4& phase, const float_4& increment, float shape, float_4& out) {
+	float_4 pos = phase * (float)WAVETABLE_SIZE;
+	float_4 index = rack::simd::fmin(rack::simd::floor(pos), (float)(WAVETABLE_SIZE - 1));
+	float_4 frac = pos - index;
+	float morph = shape * (WAVETABLE_SHAPES - 1);
+	int frame = std::min((int)morph, WAVETABLE_SHAPES - 2);
+	float morphFrac = morph - frame;
+
+	// getLevel() stops at the first level whose top harmonic fits, and the
+	// test is monotonic in the level, so counting the levels that fail gives the same answer
+	float_4 magnitude(_mm_andnot_ps(_mm_set1_ps(-0.f), increment.v));
+	__m128i level = _mm_setzero_si128();
+	for (int l = 0; l < WAVETABLE_LEVELS - 1; ++l) {
+		float_4 fails = magnitude * (float)((WAVETABLE_SIZE / 2) >> l) > 0.5f;
+		level = _mm_sub_epi32(level, _mm_castps_si128(fails.v));
+	}
+	const int stride = WAVETABLE_SIZE + 1;
+	__m128i offset = _mm_add_epi32(
+		_mm_mullo_epi32(_mm_add_epi32(level, _mm_set1_epi32(frame * WAVETABLE_LEVELS)), _mm_set1_epi32(stride)),
+		_mm_cvttps_epi32(index.v));
+	const float* a = &wavetable.tables[0][0][0];
+	const float* b = a + WAVETABLE_LEVELS * stride;
+	float_4 a0(_mm_i32gather_ps(a, offset, 4));
+	float_4 a1(_mm_i32gather_ps(a + 1, offset, 4));
+	float_4 b0(_mm_i32gather_ps(b, offset, 4));
+	float_4 b1(_mm_i32gather_ps(b + 1, offset, 4));
+	float_4 va = a0 + (a1 - a0) * frac;
+	float_4 vb = b0 + (b1 - b0) * frac;
+	out = va + (vb - va) * morphFrac;
+}
+
+static const DspKernels AVX2_KERNELS = {
+	"avx2", envelopeAvx2, interpolateAvx2, interpolateCompactAvx2, walkForceAvx2, wavetableAvx2
+};
+
+
+// --- avx512: 16-wide interpolator, avx2 for the rest ---
+TERROIR_TARGET_AVX512 static float interpolateAvx512(const PolyphaseKernel& kernel, const float* frames, float frac, int bank) {
+	float x = frac * INTERP_PHASES;
+	int p = std::min((int)x, INTERP_PHASES - 1);
+	__m512 mu = _mm512_set1_ps(x - p);
+	const float* row0 = kernel.coeffs[bank][p];
+	const float* row1 = kernel.coeffs[bank][p + 1];
+	const float* src = frames - (INTERP_HALF_TAPS - 1);
+	__m512 sum = _mm512_setzero_ps();
+	for (int t = 0; t < INTERP_TAPS; t += 16) {
+		__m512 c0 = _mm512_loadu_ps(row0 + t);
+		__m512 c = _mm512_fmadd_ps(_mm512_sub_ps(_mm512_loadu_ps(row1 + t), c0), mu, c0);
+		sum = _mm512_fmadd_ps(_mm512_loadu_ps(src + t), c, sum);
+	}
+	return _mm512_reduce_add_ps(sum);
+}
+
+TERROIR_TARGET_AVX512 static float interpolateCompactAvx512(const PolyphaseKernel& kernel, const int16_t* frames, float frac, int bank, float scale) {
+	float x = frac * INTERP_PHASES;
+	int p = std::min((int)x, INTERP_PHASES - 1);
+	__m512 mu = _mm512_set1_ps(x - p);
+	const float* row0 = kernel.coeffs[bank][p];
+	const float* row1 = kernel.coeffs[bank][p + 1];
+	const int16_t* src = frames - (INTERP_HALF_TAPS - 1);
+	__m512 sum = _mm512_setzero_ps();
+	for (int t = 0; t < INTERP_TAPS; t += 16) {
+		__m512 c0 = _mm512_loadu_ps(row0 + t);
+		__m512 c = _mm512_fmadd_ps(_mm512_sub_ps(_mm512_loadu_ps(row1 + t), c0), mu, c0);
+		__m512 s = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)(src + t))));
+		sum = _mm512_fmadd_ps(s, c, sum);
+	}
+	return _mm512_reduce_add_ps(sum) * scale;
+}
+
+static const DspKernels AVX512_KERNELS = {
+	"avx512", envelopeAvx2, interpolateAvx512, interpolateCompactAvx512, walkForceAvx2, wavetableAvx2
+};
+#endif
+
+
+// --- Selection ---
+std::vector<const DspKernels*> DspKernels::getSupported() {
+	std::vector<const DspKernels*> sets = {&SSE2_KERNELS};
+#if TERROIR_KERNELS_X86
+	// These also check that the OS saves the wider registers
+	__builtin_cpu_init();
+	bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if (avx2) sets.push_back(&AVX2_KERNELS);
+	if (avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) sets.push_back(&AVX512_KERNELS);
+#endif
+	return sets;
+}
+
+const DspKernels& DspKernels::select(const char* name) {
+	std::vector<const DspKernels*> sets = getSupported();
+	active = sets.back();
+	if (name) {
+		for (const DspKernels* set : sets)
+			if (!std::strcmp(set->name, name)) active = set;
+	}
+	return *active;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <simd/Vector.hpp>
+#include <cstdint>
+#include <vector>
+
+struct EnvelopeShape4;
+struct PolyphaseKernel;
+struct WendWavetable;
+
+// --- DSP Kernel Dispatch ---
+// The plugin is compiled for the x86-64 baseline (SSE2) so one binary runs
+// everywhere, but the heaviest per-sample kernels are also built for wider
+// instruction sets, and init() points DspKernels::get() at the best set the
+// host CPU supports. Modules call through the table instead of the inline
+// headers; the tables never change after init(), so the indirect calls
+// always predict.
+//
+//   sse2    The inline header code as-is.
+//   avx2    AVX2 + FMA: the interpolator runs its 32 taps as four 8-wide
+//           fused multiply-adds, the envelope and wavetable reads use
+//           hardware gathers, and everything else is recompiled with VEX
+//           encoding and FMA contraction.
+//   avx512  As avx2, with the interpolator taps in two 16-wide steps.
+//
+// Results match the baseline to float rounding (FMA and summation order
+// differ), well below anything audible. Vectors cross the table by
+// reference: float_4 is a union, which the x86-64 ABI passes and returns as
+// two 8-byte halves, and the store-forwarding stall that causes costs more
+// than a small kernel itself.
+
+struct DspKernels {
+	const char* name;
+	void (*envelope)(const EnvelopeShape4& shape, const rack::simd::float_4& t, rack::simd::float_4& env);
+	float (*interpolate)(const PolyphaseKernel& kernel, const float* frames, float frac, int bank);
+	float (*interpolateCompact)(const PolyphaseKernel& kernel, const int16_t* frames, float frac, int bank, float scale);
+	void (*walkForce)(const rack::simd::float_4& value, const rack::simd::float_4& bias, const rack::simd::float_4& lower, const rack::simd::float_4& upper, const rack::simd::float_4& pull, rack::simd::float_4& force);
+	void (*wavetable)(const WendWavetable& wavetable, const rack::simd::float_4& phase, const rack::simd::float_4& increment, float shape, rack::simd::float_4& out);
+
+	// The baseline set until select() runs
+	static const DspKernels& get() { return *active; }
+
+	// Makes the named set active, or the best supported one if name is null
+	// or not supported here. Call once, before any module processes.
+	static const DspKernels& select(const char* name = nullptr);
+
+	// Every set this CPU can run, baseline first
+	static std::vector<const DspKernels*> getSupported();
+
+private:
+	static const DspKernels* active;
+};
@@ -0,0 +1,253 @@
+#pragma once
+#include <rack.hpp>
+#include "Kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// --- Lure Lattice Tables ---
+// A Lure walker moves in fixed steps from its anchor (where it started, or
+// the edge it was last clamped to), so it always sits on a lattice state:
+// value = origin + state * step. For a given field (range, bias and pull)
+// the chance of stepping up from each state never changes, which makes the
+// walk a Markov chain over at most LATTICE_STATES states. A LatticeTable
+// caches that chain for one walker:
+// - the up probability of each state, filled the first time the walker
+//   asks for it;
+// - for a walker taking several steps per sample, where `steps` steps from
+//   each state can end up, so a single draw takes them all. Rows are kept
+//   for the LATTICE_ROW_SETS jump lengths used most recently, so a moving
+//   SPEED only rebuilds rows for lengths it hasn't met lately. They live in
+//   a separate LatticeRows, handed to the table before its first jump.
+// A new field or origin invalidates everything in O(1) by moving to a new
+// epoch, and only states the walker actually reaches are ever computed.
+
+static const int LATTICE_STATES = 301;  // Lure's 15 V range in 0.05 V steps, both ends included
+static const int LATTICE_MAX_JUMP = 32; // Most steps one draw can take
+static const int LATTICE_ROW_SETS = 4;  // Jump lengths a table keeps rows for at once
+
+// Chance that a walker under force F steps up next
+inline rack::simd::float_4 walkUpProbability(const rack::simd::float_4& force) {
+	return 0.5f + 0.5f * rack::simd::clamp(force, -1.f, 1.f);
+}
+
+// Jump rows for one LatticeTable, LATTICE_ROW_SETS jump lengths at a time
+struct LatticeRows {
+	static const int ROW_SIZE = (LATTICE_MAX_JUMP + 4) & ~3; // Outcomes 0..steps, padded to whole float_4s
+
+	// The rows for one jump length: per state, the cumulative probability of
+	// ending (steps - 2m) below to (steps) above it, for m = 0..steps. A
+	// negative first entry marks a state whose walk could reach an edge, and
+	// entries past the last reachable outcome hold 2, above any draw.
+	struct RowSet {
+		int steps = 0; // 0 while unused
+		uint64_t generation = 0; // Table key the rows were built for
+		uint32_t epoch = 1;
+		uint32_t lastUse = 0;
+		uint32_t stamps[LATTICE_STATES] = {};
+		float cdf[LATTICE_STATES * ROW_SIZE];
+	};
+	RowSet sets[LATTICE_ROW_SETS];
+	uint32_t clock = 0;
+};
+
+struct LatticeTable {
+	// What the cached probabilities hold for
+	float lower = 0.f, upper = 0.f, bias = 0.f, pull = 0.f;
+	float origin = 0.f; // Value of state 0
+	float step = 1.f;
+
+	float value(int state) const { return origin + state * step; }
+
+	// Both return true if the key changed
+	bool setField(float newLower, float newUpper, float newBias, float newPull) {
+		if (newLower == lower && newUpper == upper && newBias == bias && newPull == pull) return false;
+		lower = newLower;
+		upper = newUpper;
+		bias = newBias;
+		pull = newPull;
+		invalidate();
+		return true;
+	}
+
+	bool setOrigin(float newOrigin, float newStep) {
+		if (newOrigin == origin && newStep == step) return false;
+		origin = newOrigin;
+		step = newStep;
+		invalidate();
+		return true;
+	}
+
+	// Whether `other` caches the same walk, so either table serves both walkers
+	bool hasSameKey(const LatticeTable& other) const {
+		return lower == other.lower && upper == other.upper && bias == other.bias && pull == other.pull
+			&& origin == other.origin && step == other.step;
+	}
+
+	// The cached up probability of `state`, if it has one
+	bool getUp(int state, float& up) const {
+		if (upEpoch[state] != epoch) return false;
+		up = upProbability[state];
+		return true;
+	}
+
+	void setUp(int state, float up) {
+		upProbability[state] = up;
+		upEpoch[state] = epoch;
+	}
+
+	// Draws where `steps` steps from `state` end up, given a uniform `draw`.
+	// False if a walk that long could reach an edge, where the walker gets
+	// clamped and re-anchored: those steps have to be taken one at a time.
+	// Needs rows from setRows().
+	bool jump(int state, int steps, float draw, int& target) {
+		LatticeRows::RowSet& set = getRows(steps);
+		set.lastUse = ++rows->clock;
+		float* cdf = &set.cdf[state * LatticeRows::ROW_SIZE];
+		if (set.stamps[state] != set.epoch) {
+			if (boundsStale) findBounds();
+			buildRow(state, steps, cdf);
+			set.stamps[state] = set.epoch;
+		}
+		if (cdf[0] < 0.f) return false;
+
+		// The outcome is the number of cumulative probabilities the draw has
+		// passed. Counting them four at a time keeps the walker's next state
+		// off a chain of dependent loads, unlike a binary search.
+		int outcome = 0;
+		for (int m = 0; m <= steps; m += 4)
+			outcome += __builtin_popcount(rack::simd::movemask(rack::simd::float_4::load(cdf + m) <= draw));
+		target = state - steps + 2 * outcome;
+		return true;
+	}
+
+	// Whether jumps of `steps` would keep their rows without evicting another length's
+	bool hasRowsFor(int steps) const {
+		for (const LatticeRows::RowSet& set : rows->sets) {
+			if (set.steps == steps || set.steps == 0) return true;
+		}
+		return false;
+	}
+
+	// Rows this table's jumps are drawn from. The owner keeps them, and they
+	// may start out holding another key's rows.
+	void setRows(LatticeRows* newRows) { rows = newRows; }
+
+private:
+	uint32_t epoch = 1;
+	uint64_t generation = 0; // Counts key changes; unlike `epoch` it never wraps
+	int first = 0, last = -1; // States inside [lower, upper], found when a jump first needs them
+	bool boundsStale = true;
+	uint32_t upEpoch[LATTICE_STATES] = {};
+	float upProbability[LATTICE_STATES];
+
+	LatticeRows* rows = nullptr;
+
+	void invalidate() {
+		if (++epoch == 0) {
+			// Wrapped: stamps from 2^32 epochs ago would look current
+			std::fill(upEpoch, upEpoch + LATTICE_STATES, 0u);
+			epoch = 1;
+		}
+		++generation; // Leaves the row sets stale, checked as they are used
+		boundsStale = true;
+	}
+
+	// The rows for `steps` under the current key, taking over the least
+	// recently used set if no set holds them
+	LatticeRows::RowSet& getRows(int steps) {
+		LatticeRows::RowSet* found = nullptr;
+		LatticeRows::RowSet* oldest = &rows->sets[0];
+		for (LatticeRows::RowSet& set : rows->sets) {
+			if (set.steps == steps) found = &set;
+			if (set.lastUse < oldest->lastUse) oldest = &set;
+		}
+		LatticeRows::RowSet& set = found ? *found : *oldest;
+		if (set.steps != steps || set.generation != generation) {
+			set.steps = steps;
+			set.generation = generation;
+			if (++set.epoch == 0) {
+				// Wrapped, as for the up probabilities
+				std::fill(set.stamps, set.stamps + LATTICE_STATES, 0u);
+				set.epoch = 1;
+			}
+		}
+		return set;
+	}
+
+	// Stepping outside these is what clamps the walker; same test as Lure's
+	void findBounds() {
+		first = std::min(std::max((int)std::ceil((lower - origin) / step), 0), LATTICE_STATES);
+		while (first > 0 && value(first - 1) >= lower) --first;
+		while (first < LATTICE_STATES && value(first) < lower) ++first;
+		last = std::min(std::max((int)std::floor((upper - origin) / step), -1), LATTICE_STATES - 1);
+		while (last < LATTICE_STATES - 1 && value(last + 1) <= upper) ++last;
+		while (last >= 0 && value(last) > upper) --last;
+		boundsStale = false;
+	}
+
+	// Computes the missing up probabilities from `from` to `to`, four states a call
+	void fillUp(int from, int to) {
+		using rack::simd::float_4;
+		int pending[4];
+		int count = 0;
+		for (int state = from; state <= to + 1; ++state) {
+			bool flush = (state > to) ? count > 0 : count == 4;
+			if (flush) {
+				float_4 values;
+				for (int i = 0; i < 4; ++i) values[i] = value(pending[std::min(i, count - 1)]);
+				float_4 force;
+				DspKernels::get().walkForce(values, float_4(bias), float_4(lower), float_4(upper), float_4(pull), force);
+				float_4 up = walkUpProbability(force);
+				for (int i = 0; i < count; ++i) setUp(pending[i], up[i]);
+				count = 0;
+			}
+			if (state <= to && upEpoch[state] != epoch) pending[count++] = state;
+		}
+	}
+
+	// Pushes the distribution one step at a time. The up probabilities are
+	// exact 0s and 1s within a step of an edge (the repulsion saturates the
+	// force), so a walk from inside the range almost never finds an edge.
+	void buildRow(int state, int steps, float* cdf) {
+		cdf[0] = -1.f;
+		if (state < first || state > last) return;
+		fillUp(std::max(state - steps, first), std::min(state + steps, last));
+
+		// Offset k holds the chance of being at state - steps + k. The checks
+		// below keep every state the walk reaches inside [first, last].
+		float dist[2 * LATTICE_MAX_JUMP + 1] = {};
+		float next[2 * LATTICE_MAX_JUMP + 1];
+		dist[steps] = 1.f;
+		for (int n = 0; n < steps; ++n) {
+			std::fill(next, next + 2 * steps + 1, 0.f);
+			for (int k = steps - n; k <= steps + n; k += 2) {
+				float p = dist[k];
+				if (p == 0.f) continue;
+				int s = state - steps + k;
+				float up = upProbability[s];
+				if (up > 0.f) {
+					if (s + 1 > last) return;
+					next[k + 1] += p * up;
+				}
+				if (up < 1.f) {
+					if (s - 1 < first) return;
+					next[k - 1] += p * (1.f - up);
+				}
+			}
+			std::copy(next, next + 2 * steps + 1, dist);
+		}
+
+		// After `steps` steps only offsets of matching parity are reachable
+		float sum = 0.f;
+		int lastReachable = 0;
+		for (int m = 0; m <= steps; ++m) {
+			sum += dist[2 * m];
+			cdf[m] = sum;
+			if (dist[2 * m] > 0.f) lastReachable = m;
+		}
+		// Rounding can leave the total just under 1; the top reachable outcome takes the rest
+		for (int m = lastReachable; m < LatticeRows::ROW_SIZE; ++m) cdf[m] = 2.f;
+	}
+};
@@ -0,0 +1,170 @@
+#pragma once
+#include <simd/Vector.hpp>
+#include <simd/functions.hpp>
+#include <algorithm>
+#include <cmath>
+#include "Kaiser.hpp"
+
+// --- Half-band Oversampler ---
+// 2x, 4x or 8x oversampling around a nonlinearity, built from cascaded 2x
+// stages. Every stage uses the same half-band FIR, HALFBAND_LENGTH taps: a
+// Kaiser-windowed sinc at a quarter of the stage's output rate. A half-band
+// filter is zero at every other tap except the center, so in polyphase form
+// one branch is the 0.5 center tap (a pure delay) and the other is
+// HALFBAND_PHASE_TAPS multiply-adds. Upsampling and downsampling by 2 each
+// cost one such branch per base-rate sample of the stage, so total work
+// roughly doubles with each factor step.
+//
+// T is float for one voice or simd::float_4 for four voices in lanes; the
+// coefficients are scalars either way.
+
+constexpr int HALFBAND_PHASE_TAPS = 24;
+constexpr int HALFBAND_LENGTH = 2 * HALFBAND_PHASE_TAPS - 1;
+constexpr int HALFBAND_CENTER_DELAY = HALFBAND_PHASE_TAPS / 2 - 1; // Center tap, in base-rate samples
+constexpr double HALFBAND_KAISER_BETA = 8.0;
+constexpr int OVERSAMPLE_MAX_STAGES = 3;
+
+struct HalfbandKernel {
+	// Even-index taps h[2j] of the full filter, j = 0..HALFBAND_PHASE_TAPS - 1
+	float taps[HALFBAND_PHASE_TAPS];
+
+	static const HalfbandKernel& get() {
+		static const HalfbandKernel kernel;
+		return kernel;
+	}
+
+	HalfbandKernel() {
+		const int center = HALFBAND_LENGTH / 2;
+		double i0Beta = kaiserBesselI0(HALFBAND_KAISER_BETA);
+		double sum = 0.0;
+		double h[HALFBAND_PHASE_TAPS];
+		for (int j = 0; j < HALFBAND_PHASE_TAPS; ++j) {
+			int n = 2 * j - center; // Odd, so the center tap is not in this branch
+			double w = (double)n / center;
+			double window = kaiserBesselI0(HALFBAND_KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - w * w))) / i0Beta;
+			h[j] = std::sin(M_PI * n / 2.0) / (M_PI * n) * window;
+			sum += h[j];
+		}
+		// With the 0.5 center tap the filter has unity gain at DC
+		for (int j = 0; j < HALFBAND_PHASE_TAPS; ++j) taps[j] = (float)(h[j] * 0.5 / sum);
+	}
+};
+
+// Base-rate history for one polyphase branch. Each value is written twice so
+// the newest HALFBAND_PHASE_TAPS values are always contiguous.
+template <typename T>
+struct HalfbandHistory {
+	T values[2 * HALFBAND_PHASE_TAPS] = {};
+	int pos = 0;
+
+	void push(T x) {
+		pos = (pos == 0) ? HALFBAND_PHASE_TAPS - 1 : pos - 1;
+		values[pos] = x;
+		values[pos + HALFBAND_PHASE_TAPS] = x;
+	}
+	// values[pos + k] is the value pushed k samples ago
+	T convolve() const {
+		const HalfbandKernel& kernel = HalfbandKernel::get();
+		const T* x = values + pos;
+		T sum = 0.f;
+		for (int j = 0; j < HALFBAND_PHASE_TAPS; ++j) sum += x[j] * kernel.taps[j];
+		return sum;
+	}
+	T delayed(int k) const { return values[pos + k]; }
+	void reset() { *this = HalfbandHistory(); }
+};
+
+template <typename T>
+struct HalfbandUpsampler {
+	HalfbandHistory<T> history;
+
+	// Two output samples per input; gain 2 restores the zero-stuffed level
+	void process(T in, T* out) {
+		history.push(in);
+		out[0] = 2.f * history.convolve();
+		out[1] = history.delayed(HALFBAND_CENTER_DELAY);
+	}
+	void reset() { history.reset(); }
+};
+
+template <typename T>
+struct HalfbandDownsampler {
+	HalfbandHistory<T> odd;
+	HalfbandHistory<T> even;
+
+	// One output sample per pair of inputs
+	T process(const T* in) {
+		even.push(in[0]);
+		odd.push(in[1]);
+		return odd.convolve() + 0.5f * even.delayed(HALFBAND_CENTER_DELAY);
+	}
+	void reset() { odd.reset(); even.reset(); }
+};
+
+template <typename T>
+struct HalfbandOversampler {
+	HalfbandUpsampler<T> up[OVERSAMPLE_MAX_STAGES];
+	HalfbandDownsampler<T> down[OVERSAMPLE_MAX_STAGES];
+	int stages = 0;
+
+	// 1, 2, 4 or 8
+	void setFactor(int factor) {
+		int newStages = 0;
+		while ((1 << newStages) < factor && newStages < OVERSAMPLE_MAX_STAGES) ++newStages;
+		if (newStages == stages) return;
+		stages = newStages;
+		reset();
+	}
+	int getFactor() const { return 1 << stages; }
+
+	void reset() {
+		for (int s = 0; s < OVERSAMPLE_MAX_STAGES; ++s) { up[s].reset(); down[s].reset(); }
+	}
+
+	// Runs `shaper` (a functor T -> T) at the oversampled rate
+	template <typename F>
+	T process(T in, const F& shaper) {
+		T bufferA[1 << OVERSAMPLE_MAX_STAGES];
+		T bufferB[1 << OVERSAMPLE_MAX_STAGES];
+		T* src = bufferA;
+		T* dst = bufferB;
+		src[0] = in;
+		int count = 1;
+		for (int s = 0; s < stages; ++s) {
+			for (int i = 0; i < count; ++i) up[s].process(src[i], dst + 2 * i);
+			count *= 2;
+			std::swap(src, dst);
+		}
+		for (int i = 0; i < count; ++i) src[i] = shaper(src[i]);
+		for (int s = stages - 1; s >= 0; --s) {
+			count /= 2;
+			for (int i = 0; i < count; ++i) dst[i] = down[s].process(src + 2 * i);
+			std::swap(src, dst);
+		}
+		return src[0];
+	}
+};
+
+// Pade approximation of tanh, exact at +-3 where it meets its limit with zero
+// slope; inputs are clamped there. Scaled so a unit input always peaks at 1.
+struct SoftClipShaper {
+	float gain = 1.f;
+	float norm = 1.f;
+
+	void setGain(float g) {
+		gain = g;
+		norm = 1.f / curve(g);
+	}
+
+	static float curve(float x) {
+		x = std::fmin(std::fmax(x, -3.f), 3.f);
+		return x * (27.f + x * x) / (27.f + 9.f * x * x);
+	}
+
+	template <typename T>
+	T operator()(T x) const {
+		using namespace rack::simd;
+		x = fmin(fmax(x * gain, T(-3.f)), T(3.f));
+		return norm * x * (27.f + x * x) / (27.f + 9.f * x * x);
+	}
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <simd/Vector.hpp>
+#include <cstdint>
+#include <emmintrin.h>
+
+// --- Per-lane Random Streams ---
+// Four independent xoshiro128+ generators, one per float_4 lane, stepped
+// together with SSE2 integer ops: one call yields four uniforms for about
+// a dozen instructions, with no shared or thread-local state. Each lane is
+// seeded from (seed, stream) through SplitMix64, so a lane's sequence
+// depends only on the seed and its own stream number, never on how many
+// other lanes exist or how often they draw.
+
+struct LaneRandom {
+	__m128i s0, s1, s2, s3; // Word k of every lane's state
+
+	LaneRandom() { seed(0, 0); }
+
+	static uint64_t splitMix64(uint64_t& x) {
+		uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// Lanes get streams firstStream .. firstStream + 3
+	void seed(uint64_t seed, uint32_t firstStream) {
+		alignas(16) uint32_t words[4][4];
+		for (int lane = 0; lane < 4; ++lane) {
+			uint64_t x = seed ^ ((uint64_t)(firstStream + lane) * 0xd1b54a32d192ed03ull);
+			uint64_t a = splitMix64(x);
+			uint64_t b = splitMix64(x);
+			words[0][lane] = (uint32_t)a;
+			words[1][lane] = (uint32_t)(a >> 32);
+			words[2][lane] = (uint32_t)b;
+			words[3][lane] = (uint32_t)(b >> 32) | 1u; // Never the all-zero state
+		}
+		s0 = _mm_load_si128((const __m128i*)words[0]);
+		s1 = _mm_load_si128((const __m128i*)words[1]);
+		s2 = _mm_load_si128((const __m128i*)words[2]);
+		s3 = _mm_load_si128((const __m128i*)words[3]);
+	}
+
+	// Uniform in [0, 1) per lane. Only lanes set in `advance` (a comparison
+	// mask) move to their next state; the others return their next value
+	// again on the following call.
+	rack::simd::float_4 uniform(rack::simd::float_4 advance) {
+		__m128i result = _mm_add_epi32(s0, s3);
+		__m128i t = _mm_slli_epi32(s1, 9);
+		__m128i n2 = _mm_xor_si128(s2, s0);
+		__m128i n3 = _mm_xor_si128(s3, s1);
+		__m128i n1 = _mm_xor_si128(s1, n2);
+		__m128i n0 = _mm_xor_si128(s0, n3);
+		n2 = _mm_xor_si128(n2, t);
+		n3 = _mm_or_si128(_mm_slli_epi32(n3, 11), _mm_srli_epi32(n3, 21));
+
+		__m128i mask = _mm_castps_si128(advance.v);
+		s0 = select(mask, n0, s0);
+		s1 = select(mask, n1, s1);
+		s2 = select(mask, n2, s2);
+		s3 = select(mask, n3, s3);
+
+		// Top 24 bits, exact in a float
+		__m128 top = _mm_cvtepi32_ps(_mm_srli_epi32(result, 8));
+		return rack::simd::float_4(_mm_mul_ps(top, _mm_set1_ps(1.f / 16777216.f)));
+	}
+
+	rack::simd::float_4 uniform() {
+		return uniform(rack::simd::float_4::mask());
+	}
+
+private:
+	static __m128i select(__m128i mask, __m128i a, __m128i b) {
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "Kaiser.hpp"
+
+// --- Windowed-Sinc Resampler ---
+// One-shot, offline conversion of a looping buffer to a new sample rate. The
+// kernel is a Kaiser-windowed sinc tabulated at RESAMPLER_PHASES points per
+// input sample (linearly interpolated between them), with its cutoff lowered
+// to the output Nyquist when downsampling. Input indices wrap, so the loop
+// point stays seamless; the output length is rounded and the ratio adjusted
+// so exactly one loop maps onto it.
+
+constexpr int RESAMPLER_ZERO_CROSSINGS = 32;
+constexpr int RESAMPLER_PHASES = 512;
+constexpr double RESAMPLER_KAISER_BETA = 9.0;
+constexpr double RESAMPLER_PASSBAND = 0.97; // Fraction of the lower Nyquist kept
+
+struct SincResampler {
+	double cutoff;    // Normalized to the input Nyquist
+	int halfWidth;    // Kernel half-width in input samples
+	std::vector<float> kernel; // kernel[k] = h(k / RESAMPLER_PHASES), k >= 0
+
+	explicit SincResampler(double ratio) {
+		cutoff = std::min(1.0, ratio) * RESAMPLER_PASSBAND;
+		halfWidth = (int)std::ceil(RESAMPLER_ZERO_CROSSINGS / cutoff);
+		int points = halfWidth * RESAMPLER_PHASES;
+		kernel.resize(points + 2);
+		double i0Beta = kaiserBesselI0(RESAMPLER_KAISER_BETA);
+		for (int k = 0; k <= points; ++k) {
+			double x = (double)k / RESAMPLER_PHASES;
+			double t = x / halfWidth;
+			double window = kaiserBesselI0(RESAMPLER_KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - t * t))) / i0Beta;
+			double arg = M_PI * cutoff * x;
+			double sinc = (k == 0) ? 1.0 : std::sin(arg) / arg;
+			kernel[k] = (float)(cutoff * sinc * window);
+		}
+		kernel[points + 1] = 0.f;
+	}
+
+	// Resamples one loop of `in` to `outLength` frames
+	void process(const float* in, size_t inLength, size_t outLength, std::vector<float>& out) const {
+		out.assign(outLength, 0.f);
+		if (inLength == 0 || outLength == 0) return;
+		double step = (double)inLength / outLength;
+		long length = (long)inLength;
+		for (size_t n = 0; n < outLength; ++n) {
+			double pos = n * step;
+			long i0 = (long)std::floor(pos);
+			double frac = pos - i0;
+			double sum = 0.0;
+			double weights = 0.0;
+			for (int j = -halfWidth + 1; j <= halfWidth; ++j) {
+				double x = std::fabs(j - frac) * RESAMPLER_PHASES;
+				int k = (int)x;
+				if (k >= (int)kernel.size() - 1) continue;
+				double w = kernel[k] + (kernel[k + 1] - kernel[k]) * (x - k);
+				long index = (i0 + j) % length;
+				if (index < 0) index += length;
+				sum += w * in[index];
+				weights += w;
+			}
+			// Normalizing by the kernel sum removes passband ripple at DC
+			out[n] = (float)((weights != 0.0) ? sum / weights : sum);
+		}
+	}
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <rack.hpp>
+
+// --- Lure Walk Force ---
+// Net force on four walkers: gravity toward the bias point, scaled by PULL
+// and shaped by the walker's distance relative to the room on its side, plus
+// a repulsion from each edge that grows as the walker nears it. Positive
+// pushes up. Lure turns it into the probability of the next step going up.
+
+constexpr float WALK_EPSILON = 1e-3f;          // Prevent division by zero at edges
+constexpr float WALK_EDGE_REPEL_FACTOR = 0.03f;
+constexpr float WALK_EDGE_EXPONENT = 1.51f;
+constexpr float WALK_GRAVITY_EXPONENT = 2.5f;  // Distance-squared-ish gravity curve
+
+inline rack::simd::float_4 walkForce(rack::simd::float_4 value, rack::simd::float_4 bias, rack::simd::float_4 lower, rack::simd::float_4 upper, rack::simd::float_4 pullParam) {
+	using rack::simd::float_4;
+	float_4 below = value < bias;
+	float_4 denom = rack::simd::ifelse(below, bias - lower, upper - bias);
+	float_4 dist = rack::simd::ifelse(below, bias - value, value - bias);
+	float_4 relative = rack::simd::ifelse(denom > 0.f, dist / denom, 0.f);
+
+	relative = rack::simd::clamp(relative, 0.f, 1.f);
+	float_4 gravity = pullParam * rack::simd::ifelse(relative > 0.f, rack::simd::pow(relative, float_4(WALK_GRAVITY_EXPONENT)), 0.f);
+	float_4 F_center = rack::simd::ifelse(below, gravity, -gravity);
+
+	// Edge repulsion (distances floored at WALK_EPSILON so a range that moved
+	// past the walker cannot feed a negative base into pow)
+	float_4 distFromMin = rack::simd::fmax(value - lower + WALK_EPSILON, WALK_EPSILON);
+	float_4 distFromMax = rack::simd::fmax(upper - value + WALK_EPSILON, WALK_EPSILON);
+	float_4 F_edge = WALK_EDGE_REPEL_FACTOR * (
+		1.f / rack::simd::pow(distFromMin, float_4(WALK_EDGE_EXPONENT)) -
+		1.f / rack::simd::pow(distFromMax, float_4(WALK_EDGE_EXPONENT))
+	);
+
+	return F_center + F_edge;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <rack.hpp>
+#include <algorithm>
+#include <cmath>
+
+// --- Wend Wavetables ---
+// Each of Wend's soft shapes is sampled once, taken to the frequency domain
+// and resynthesized into WAVETABLE_LEVELS octave tables: level l keeps the
+// harmonics up to (WAVETABLE_SIZE / 2) >> l, so the last level is a pure
+// sine. The oscillator picks the lowest level whose top harmonic stays under
+// Nyquist for its phase increment, which keeps every shape alias-free up to
+// the top of the FREQ range at a cost of two table reads per shape frame.
+// All levels of a shape share the gain that normalizes level 0 to +-1.
+
+constexpr int WAVETABLE_SIZE = 2048;
+constexpr int WAVETABLE_LEVELS = 11;
+constexpr int WAVETABLE_SHAPES = 4;
+
+struct WendWavetable {
+	// One guard point past the end so the interpolation never wraps (~360 kB in all)
+	float tables[WAVETABLE_SHAPES][WAVETABLE_LEVELS][WAVETABLE_SIZE + 1];
+
+	static const WendWavetable& get() {
+		static const WendWavetable wavetable;
+		return wavetable;
+	}
+
+	WendWavetable() {
+		rack::dsp::RealFFT fft(WAVETABLE_SIZE);
+		alignas(16) float wave[WAVETABLE_SIZE];
+		alignas(16) float spectrum[WAVETABLE_SIZE];
+		alignas(16) float filtered[WAVETABLE_SIZE];
+		for (int s = 0; s < WAVETABLE_SHAPES; ++s) {
+			for (int i = 0; i < WAVETABLE_SIZE; ++i) wave[i] = shapeFunction(s, (float)i / WAVETABLE_SIZE);
+			fft.rfft(wave, spectrum);
+			float gain = 1.f;
+			for (int level = 0; level < WAVETABLE_LEVELS; ++level) {
+				// Ordered spectrum: [DC, Nyquist, re(1), im(1), re(2), im(2), ...]
+				int maxHarmonic = (WAVETABLE_SIZE / 2) >> level;
+				std::copy(spectrum, spectrum + WAVETABLE_SIZE, filtered);
+				filtered[0] = 0.f;
+				filtered[1] = 0.f;
+				for (int h = maxHarmonic + 1; h < WAVETABLE_SIZE / 2; ++h) {
+					filtered[2 * h] = 0.f;
+					filtered[2 * h + 1] = 0.f;
+				}
+				float* table = tables[s][level];
+				fft.irfft(filtered, table);
+				if (level == 0) {
+					float peak = 0.f;
+					for (int i = 0; i < WAVETABLE_SIZE; ++i) peak = std::max(peak, std::fabs(table[i]));
+					gain = (peak > 0.f) ? 1.f / peak : 1.f;
+				}
+				for (int i = 0; i < WAVETABLE_SIZE; ++i) table[i] *= gain;
+				table[WAVETABLE_SIZE] = table[0];
+			}
+		}
+	}
+
+	// The shape frames SHAPE morphs through, over one cycle x in [0, 1)
+	static float shapeFunction(int shape, float x) {
+		float theta = 2.f * (float)M_PI * x;
+		switch (shape) {
+			default:
+			case 0: return std::sin(theta);                                      // Sine
+			case 1: return std::asin(0.95f * std::sin(theta));                   // Rounded triangle
+			case 2: return std::tanh(2.5f * std::sin(theta));                    // Soft square
+			case 3: return std::sin(theta + 0.7f * std::sin(theta));             // Skewed sine (soft saw)
+		}
+	}
+
+	// Lowest level whose harmonics all stay below Nyquist at this increment (cycles per sample)
+	static int getLevel(float increment) {
+		int level = 0;
+		while (level < WAVETABLE_LEVELS - 1 && increment * ((WAVETABLE_SIZE / 2) >> level) > 0.5f) ++level;
+		return level;
+	}
+
+	// Four voices at once. phase in [0, 1), increment in cycles per sample (either
+	// sign) picks each lane's octave table, shape in [0, 1] morphs through the
+	// frames. Index and interpolation math is vectorized; only the table reads
+	// are per lane, since each voice may sit in a different level.
+	rack::simd::float_4 evaluate(rack::simd::float_4 phase, rack::simd::float_4 increment, float shape) const {
+		using rack::simd::float_4;
+		float_4 pos = phase * (float)WAVETABLE_SIZE;
+		float_4 index = rack::simd::fmin(rack::simd::floor(pos), (float)(WAVETABLE_SIZE - 1));
+		float_4 frac = pos - index;
+		float morph = shape * (WAVETABLE_SHAPES - 1);
+		int frame = std::min((int)morph, WAVETABLE_SHAPES - 2);
+		float morphFrac = morph - frame;
+
+		float_4 a0, a1, b0, b1;
+		for (int i = 0; i < 4; ++i) {
+			int level = getLevel(std::fabs(increment[i]));
+			int offset = (int)index[i];
+			const float* a = tables[frame][level] + offset;
+			const float* b = tables[frame + 1][level] + offset;
+			a0[i] = a[0]; a1[i] = a[1];
+			b0[i] = b[0]; b1[i] = b[1];
+		}
+		float_4 va = a0 + (a1 - a0) * frac;
+		float_4 vb = b0 + (b1 - b0) * frac;
+		return va + (vb - va) * morphFrac;
+	}
+};
@@ -1,43 +1,30 @@
-#pragma once
-#include "rack.hpp"
-
-using namespace rack;
-
-struct Magpie125 : app::SvgKnob {
-    SvgWidget* background = nullptr;
-    Magpie125() {
-        // Set foreground (indicator ring)
-        auto knobSvg = APP->window->loadSvg(asset::plugin(pluginInstance, "res/Magpie125G.svg"));
-        setSvg(knobSvg);
-
-        // Match box size to SVG size
-        if (!children.empty()) {
-            auto knobWidget = dynamic_cast<SvgWidget*>(children.front());
-            if (knobWidget) {
-                box.size = knobWidget->box.size;
-            }
-        }
-
-        // Set background (knob face)
-        background = new SvgWidget();
-        background->setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Magpie125G_bg.svg")));
-        background->box.size = box.size;
-        background->box.pos = Vec(0, 0);
-        addChildBelow(background, children.front());
-
-        // Standard VCV-style 270° sweep (-135° to +135°)
-        minAngle = -M_PI * 0.75f;
-        maxAngle =  M_PI * 0.75f;
-        if (shadow) shadow->hide();
-    }
-
-    void step() override {
-        SvgKnob::step();
-
-        // Ensure background stays sized and positioned correctly
-        if (background) {
-            background->box.size = box.size;
-            background->box.pos = Vec(0, 0);
-        }
-    }
-};
+#pragma once
+#include "rack.hpp"
+
+using namespace rack;
+
+struct Magpie125 : app::SvgKnob {
+    // The knob face never moves, so it is rasterized once into its own
+    // framebuffer under SvgKnob's. Turning the knob only redraws the
+    // indicator ring, and an idle knob is two cached image blits.
+    widget::FramebufferWidget* backgroundFb = nullptr;
+
+    Magpie125() {
+        // Set foreground (indicator ring); setSvg also sizes the knob to the SVG
+        auto knobSvg = APP->window->loadSvg(asset::plugin(pluginInstance, "res/Magpie125G.svg"));
+        setSvg(knobSvg);
+
+        // Set background (knob face)
+        widget::SvgWidget* background = new widget::SvgWidget();
+        background->setSvg(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Magpie125G_bg.svg")));
+        backgroundFb = new widget::FramebufferWidget();
+        backgroundFb->box.size = box.size;
+        backgroundFb->addChild(background);
+        addChildBelow(backgroundFb, fb);
+
+        // Standard VCV-style 270° sweep (-135° to +135°)
+        minAngle = -M_PI * 0.75f;
+        maxAngle =  M_PI * 0.75f;
+        if (shadow) shadow->hide();
+    }
+};
@@ -0,0 +1,582 @@
+// --- Offline Renderer ---
+// Renders Lure, Thrum and Wend to WAV files as fast as the CPU allows, for
+// batches of stems. The modules build without widgets against the stand-in
+// engine in bench/headless (as bench/ProcessBench does), and each job's
+// parameters and CV come from a script. Jobs are independent and run in
+// parallel, one per core. Linux only:
+//   make render RACK_DIR=<path to Rack SDK>
+//   tools/Render [-j <threads>] <script>...
+// Run from the repo root so Thrum finds res/sounds.
+//
+// Scripts are plain text, one directive per line; # starts a comment.
+// `job` starts a job, and directives before the first one apply to every
+// job in that script. Targets are the modules' own enum names: params
+// (SPEED_PARAM) take raw values, inputs (PITCH_INPUT, or PITCH_INPUT:3 for
+// one channel) take volts, and patching an input is implied by automating it.
+//   job <out.wav>        Output file; {n} is replaced by the repeat index
+//   module Lure|Thrum|Wend
+//   rate <Hz>            Engine sample rate (default 48000)
+//   length <seconds>     (default 10)
+//   seed <n>             Seeds the engine random source, which sets Lure's
+//                        walk (default: from the output path)
+//   repeat <count>       Renders the job count times, seed + n each
+//   gain <g>             File sample per volt (default 0.2: +-5 V is full scale)
+//   option <name> <value>  Menu options: Lure audioRate 0|1, coupling 0..5
+//                        (Walkers menu order); Thrum voices 1..8, compact
+//                        0|1; Wend oversample 1|2|4|8
+//   sample <path.wav>    Thrum's user sample
+//   input <INPUT> <channels>  Patches a cable with that many channels
+//   record <OUTPUT> [channels]  Writes an output's channels to the file, in
+//                        order of record lines (default: the first output, mono)
+//   set <target> <value>
+//   ramp <target> <time> <value> [<time> <value>...]  Linear between points,
+//                        held before the first and after the last
+//   step <target> <time> <value> [<time> <value>...]  Held from each point
+//   lfo <target> sine|square|saw <Hz> <low> <high>
+// Files are 32-bit float. Each finished job prints one line of key=value
+// pairs, including how many times faster than realtime it rendered.
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+#include "rack.hpp"
+#include "Lure.hpp"
+#include "Thrum.hpp"
+#include "Wend.hpp"
+#include "dsp/Kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+rack::Plugin* pluginInstance = nullptr;
+
+static std::mutex printMutex;
+
+void rack::logger::log(Level level, const char* filename, int line, const char* func, const char* format, ...) {
+    if (level < WARN_LEVEL) return; // Failed loads still get through
+    std::lock_guard<std::mutex> lock(printMutex);
+    va_list args;
+    va_start(args, format);
+    std::fprintf(stderr, "[%s:%d %s] ", filename, line, func);
+    std::vfprintf(stderr, format, args);
+    std::fprintf(stderr, "\n");
+    va_end(args);
+}
+
+// --- Modules ---
+struct NamedId {
+    const char* name;
+    int id;
+};
+#define NAMED_ID(Module, name) {#name, Module::name}
+
+static int findId(const std::vector<NamedId>& ids, const std::string& name) {
+    for (const NamedId& named : ids)
+        if (name == named.name) return named.id;
+    return -1;
+}
+
+struct ModuleType {
+    const char* name;
+    rack::engine::Module* (*create)();
+    std::vector<NamedId> params, inputs, outputs;
+    // Applies a menu option before the sample rate is set; false if unknown or out of range
+    bool (*setOption)(rack::engine::Module* m, const std::string& name, int value);
+};
+
+static const ModuleType moduleTypes[] = {
+    {"Lure",
+        []() -> rack::engine::Module* { return new Lure; },
+        {NAMED_ID(Lure, MIN_PARAM), NAMED_ID(Lure, MAX_PARAM), NAMED_ID(Lure, BIAS_PARAM), NAMED_ID(Lure, PULL_PARAM),
+            NAMED_ID(Lure, SPEED_PARAM), NAMED_ID(Lure, MIN_ATTENUVERTER), NAMED_ID(Lure, MAX_ATTENUVERTER),
+            NAMED_ID(Lure, BIAS_ATTENUVERTER), NAMED_ID(Lure, PULL_ATTENUVERTER), NAMED_ID(Lure, SPEED_ATTENUVERTER),
+            NAMED_ID(Lure, VOICES_PARAM)},
+        {NAMED_ID(Lure, MIN_INPUT), NAMED_ID(Lure, MAX_INPUT), NAMED_ID(Lure, BIAS_INPUT), NAMED_ID(Lure, PULL_INPUT),
+            NAMED_ID(Lure, SPEED_INPUT)},
+        {NAMED_ID(Lure, CV_OUTPUT)},
+        [](rack::engine::Module* m, const std::string& name, int value) -> bool {
+            Lure* lure = static_cast<Lure*>(m);
+            if (name == "audioRate" && value >= 0 && value <= 1) lure->setAudioRate(value != 0);
+            else if (name == "coupling" && value >= 0 && value < LURE_COUPLING_MODES) lure->couplingMode = value;
+            else return false;
+            return true;
+        }},
+    {"Thrum",
+        []() -> rack::engine::Module* { return new Thrum; },
+        {NAMED_ID(Thrum, TOTAL_DURATION_PARAM), NAMED_ID(Thrum, DUTY_CYCLE_PARAM), NAMED_ID(Thrum, BIAS_PARAM),
+            NAMED_ID(Thrum, SAMPLE_SELECT_PARAM), NAMED_ID(Thrum, DURATION_ATTEN_PARAM), NAMED_ID(Thrum, DUTY_ATTEN_PARAM),
+            NAMED_ID(Thrum, BIAS_ATTEN_PARAM)},
+        {NAMED_ID(Thrum, CLOCK_INPUT), NAMED_ID(Thrum, AUDIO_INPUT), NAMED_ID(Thrum, DURATION_CV_INPUT),
+            NAMED_ID(Thrum, DUTY_CV_INPUT), NAMED_ID(Thrum, BIAS_CV_INPUT), NAMED_ID(Thrum, PITCH_INPUT)},
+        {NAMED_ID(Thrum, AUDIO_OUTPUT), NAMED_ID(Thrum, ENV_OUTPUT)},
+        [](rack::engine::Module* m, const std::string& name, int value) -> bool {
+            Thrum* thrum = static_cast<Thrum*>(m);
+            if (name == "voices" && value >= 1 && value <= THRUM_MAX_VOICES) thrum->voiceCount = value;
+            else if (name == "compact" && value >= 0 && value <= 1) thrum->setCompactSamples(value != 0);
+            else return false;
+            return true;
+        }},
+    {"Wend",
+        []() -> rack::engine::Module* { return new Wend; },
+        {NAMED_ID(Wend, FREQ_PARAM), NAMED_ID(Wend, SHAPE_PARAM), NAMED_ID(Wend, DRIVE_PARAM), NAMED_ID(Wend, FM_PARAM)},
+        {NAMED_ID(Wend, VOCT_INPUT), NAMED_ID(Wend, FM_INPUT)},
+        {NAMED_ID(Wend, AUDIO_OUTPUT)},
+        [](rack::engine::Module* m, const std::string& name, int value) -> bool {
+            if (name != "oversample" || (value != 1 && value != 2 && value != 4 && value != 8)) return false;
+            static_cast<Wend*>(m)->oversampleFactor = value;
+            return true;
+        }},
+};
+
+// --- Jobs ---
+// Script lines keep their location, so errors found once the module is
+// known still point at the line that caused them
+struct Located {
+    std::string where; // script:line
+};
+
+struct Lane : Located {
+    enum Shape { BREAKPOINTS, SINE, SQUARE, SAW };
+    std::string target;
+    Shape shape = BREAKPOINTS;
+    bool held = false;                      // step rather than ramp
+    std::vector<std::pair<double, float>> points; // (seconds, value), in time order
+    double hz = 0.0;
+    float low = 0.f, high = 0.f;
+
+    // Resolved for the job's module
+    bool isParam = false;
+    int id = -1;
+    int channel = -1; // -1: every channel of the input
+};
+
+struct Record : Located {
+    std::string output;
+    int channels = 1;
+    int id = -1;
+};
+
+struct Option : Located {
+    std::string name;
+    int value = 0;
+};
+
+struct Cable : Located {
+    std::string input;
+    int channels = 1;
+};
+
+struct Job : Located {
+    std::string path;
+    const ModuleType* type = nullptr;
+    float sampleRate = 48000.f;
+    double seconds = 10.0;
+    bool seeded = false;
+    uint64_t seed = 0;
+    int repeat = 1;
+    float gain = 0.2f;
+    std::string samplePath;
+    std::vector<Option> options;
+    std::vector<Cable> cables;
+    std::vector<Record> records;
+    std::vector<Lane> lanes;
+};
+
+// Where automation stands at time t, walking each lane forward from the
+// point it last reached
+struct LanePlayer {
+    const Lane* lane;
+    size_t cursor = 0;
+
+    float valueAt(double t) {
+        const Lane& l = *lane;
+        switch (l.shape) {
+            case Lane::SINE: return l.low + (l.high - l.low) * (0.5f + 0.5f * (float)std::sin(2.0 * M_PI * l.hz * t));
+            case Lane::SQUARE: return (std::fmod(l.hz * t, 1.0) < 0.5) ? l.high : l.low;
+            case Lane::SAW: return l.low + (l.high - l.low) * (float)std::fmod(l.hz * t, 1.0);
+            default: break;
+        }
+        const std::vector<std::pair<double, float>>& p = l.points;
+        while (cursor + 1 < p.size() && p[cursor + 1].first <= t) ++cursor;
+        if (cursor + 1 == p.size() || t <= p[cursor].first || l.held) return p[cursor].second;
+        double x = (t - p[cursor].first) / (p[cursor + 1].first - p[cursor].first);
+        return p[cursor].second + (float)x * (p[cursor + 1].second - p[cursor].second);
+    }
+};
+
+static bool fail(const std::string& where, const std::string& message) {
+    std::lock_guard<std::mutex> lock(printMutex);
+    std::fprintf(stderr, "%s: %s\n", where.c_str(), message.c_str());
+    return false;
+}
+
+static bool parseNumber(const std::string& token, double& value) {
+    char* end = nullptr;
+    value = std::strtod(token.c_str(), &end);
+    return !token.empty() && *end == '\0' && std::isfinite(value);
+}
+
+static bool parseInt(const std::string& token, int64_t& value) {
+    char* end = nullptr;
+    value = std::strtoll(token.c_str(), &end, 0);
+    return !token.empty() && *end == '\0';
+}
+
+static bool parseLine(const std::vector<std::string>& words, Job& job, const std::string& where) {
+    const std::string& directive = words[0];
+    size_t count = words.size();
+    double number = 0.0;
+    int64_t integer = 0;
+    if (directive == "module" && count == 2) {
+        for (const ModuleType& type : moduleTypes)
+            if (words[1] == type.name) job.type = &type;
+        return job.type ? true : fail(where, "unknown module " + words[1]);
+    }
+    if (directive == "rate" && count == 2) {
+        if (!parseNumber(words[1], number) || number < 1000.0 || number > 768000.0) return fail(where, "rate must be 1000-768000 Hz");
+        job.sampleRate = (float)number;
+        return true;
+    }
+    if (directive == "length" && count == 2) {
+        if (!parseNumber(words[1], number) || number <= 0.0) return fail(where, "length must be positive");
+        job.seconds = number;
+        return true;
+    }
+    if (directive == "seed" && count == 2) {
+        if (!parseInt(words[1], integer)) return fail(where, "seed must be an integer");
+        job.seeded = true;
+        job.seed = (uint64_t)integer;
+        return true;
+    }
+    if (directive == "repeat" && count == 2) {
+        if (!parseInt(words[1], integer) || integer < 1 || integer > 100000) return fail(where, "repeat must be 1-100000");
+        job.repeat = (int)integer;
+        return true;
+    }
+    if (directive == "gain" && count == 2) {
+        if (!parseNumber(words[1], number)) return fail(where, "gain must be a number");
+        job.gain = (float)number;
+        return true;
+    }
+    if (directive == "option" && count == 3) {
+        Option option;
+        option.where = where;
+        option.name = words[1];
+        if (!parseInt(words[2], integer)) return fail(where, "option values are integers");
+        option.value = (int)integer;
+        job.options.push_back(option);
+        return true;
+    }
+    if (directive == "sample" && count == 2) {
+        job.samplePath = words[1];
+        return true;
+    }
+    if (directive == "input" && count == 3) {
+        Cable cable;
+        cable.where = where;
+        cable.input = words[1];
+        if (!parseInt(words[2], integer) || integer < 1 || integer > 16) return fail(where, "cables carry 1-16 channels");
+        cable.channels = (int)integer;
+        job.cables.push_back(cable);
+        return true;
+    }
+    if (directive == "record" && (count == 2 || count == 3)) {
+        Record record;
+        record.where = where;
+        record.output = words[1];
+        if (count == 3 && (!parseInt(words[2], integer) || integer < 1 || integer > 16)) return fail(where, "outputs carry 1-16 channels");
+        if (count == 3) record.channels = (int)integer;
+        job.records.push_back(record);
+        return true;
+    }
+
+    Lane lane;
+    lane.where = where;
+    if (count >= 2) lane.target = words[1];
+    if (directive == "set" && count == 3) {
+        if (!parseNumber(words[2], number)) return fail(where, "set takes a value");
+        lane.points.push_back(std::make_pair(0.0, (float)number));
+    }
+    else if ((directive == "ramp" || directive == "step") && count >= 4 && count % 2 == 0) {
+        lane.held = directive == "step";
+        for (size_t i = 2; i < count; i += 2) {
+            double time = 0.0;
+            if (!parseNumber(words[i], time) || !parseNumber(words[i + 1], number)) return fail(where, "points are <time> <value> pairs");
+            if (!lane.points.empty() && time <= lane.points.back().first) return fail(where, "point times must increase");
+            lane.points.push_back(std::make_pair(time, (float)number));
+        }
+    }
+    else if (directive == "lfo" && count == 6) {
+        if (words[2] == "sine") lane.shape = Lane::SINE;
+        else if (words[2] == "square") lane.shape = Lane::SQUARE;
+        else if (words[2] == "saw") lane.shape = Lane::SAW;
+        else return fail(where, "lfo shapes are sine, square and saw");
+        double low = 0.0, high = 0.0;
+        if (!parseNumber(words[3], lane.hz) || !parseNumber(words[4], low) || !parseNumber(words[5], high))
+            return fail(where, "lfo takes <Hz> <low> <high>");
+        lane.low = (float)low;
+        lane.high = (float)high;
+    }
+    else {
+        return fail(where, "can't read '" + directive + "' with " + std::to_string(count - 1) + " argument(s)");
+    }
+    job.lanes.push_back(lane);
+    return true;
+}
+
+// Resolves names against the job's module, once the whole job is read
+static bool resolveJob(Job& job) {
+    if (!job.type) return fail(job.where, "job has no module");
+    const ModuleType& type = *job.type;
+    if (job.repeat > 1 && job.path.find("{n}") == std::string::npos) return fail(job.where, "a repeated job needs {n} in its path");
+    if (!job.samplePath.empty() && std::string(type.name) != "Thrum") return fail(job.where, "only Thrum takes a sample");
+    bool ok = true;
+    std::unique_ptr<rack::engine::Module> probe(type.create());
+    for (const Option& option : job.options)
+        if (!type.setOption(probe.get(), option.name, option.value))
+            ok = fail(option.where, "no " + std::string(type.name) + " option " + option.name + " " + std::to_string(option.value));
+    for (Cable& cable : job.cables)
+        if (findId(type.inputs, cable.input) < 0) ok = fail(cable.where, cable.input + " is not a " + type.name + " input");
+    for (Record& record : job.records) {
+        record.id = findId(type.outputs, record.output);
+        if (record.id < 0) ok = fail(record.where, record.output + " is not a " + type.name + " output");
+    }
+    if (job.records.empty()) {
+        Record record;
+        record.id = type.outputs[0].id;
+        job.records.push_back(record);
+    }
+    for (Lane& lane : job.lanes) {
+        std::string name = lane.target;
+        size_t colon = name.find(':');
+        if (colon != std::string::npos) {
+            int64_t channel = 0;
+            if (!parseInt(name.substr(colon + 1), channel) || channel < 0 || channel > 15) {
+                ok = fail(lane.where, "channels are 0-15");
+                continue;
+            }
+            lane.channel = (int)channel;
+            name = name.substr(0, colon);
+        }
+        lane.id = findId(type.params, name);
+        lane.isParam = lane.id >= 0;
+        if (lane.isParam && lane.channel >= 0) ok = fail(lane.where, "params have no channels");
+        if (!lane.isParam) lane.id = findId(type.inputs, name);
+        if (lane.id < 0) ok = fail(lane.where, name + " is not a " + type.name + " param or input");
+    }
+    return ok;
+}
+
+static bool readScript(const char* filename, std::vector<Job>& jobs) {
+    std::ifstream file(filename);
+    if (!file) return fail(filename, "can't open script");
+    Job defaults;
+    Job* job = &defaults;
+    size_t first = jobs.size();
+    bool ok = true;
+    std::string text;
+    for (int line = 1; std::getline(file, text); ++line) {
+        text = text.substr(0, text.find('#'));
+        std::istringstream stream(text);
+        std::vector<std::string> words;
+        for (std::string word; stream >> word;) words.push_back(word);
+        if (words.empty()) continue;
+        std::string where = std::string(filename) + ":" + std::to_string(line);
+        if (words[0] == "job") {
+            if (words.size() != 2) {
+                ok = fail(where, "job takes an output path");
+                continue;
+            }
+            jobs.push_back(defaults);
+            job = &jobs.back();
+            job->where = where;
+            job->path = words[1];
+            continue;
+        }
+        ok = parseLine(words, *job, where) && ok;
+    }
+    if (jobs.size() == first) return fail(filename, "no jobs");
+    for (size_t j = first; j < jobs.size(); ++j) ok = resolveJob(jobs[j]) && ok;
+    return ok;
+}
+
+// --- Rendering ---
+// One output file from `job`; `index` picks the repeat
+struct Render {
+    const Job* job;
+    int index;
+};
+
+static std::string renderPath(const Render& render) {
+    std::string path = render.job->path;
+    size_t marker = path.find("{n}");
+    if (marker != std::string::npos) path.replace(marker, 3, std::to_string(render.index));
+    return path;
+}
+
+// FNV-1a, so an unseeded job renders the same wherever it lands in the batch
+static uint64_t hashPath(const std::string& path) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : path) hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+    return hash;
+}
+
+// Thrum's samples load on the pool's worker; rendering starts once they are
+// in. False if one failed, which would leave the render silent.
+static bool waitForSamples(Thrum* thrum) {
+    std::vector<SampleHandle> samples = thrum->loadedSamples;
+    if (thrum->userSample) samples.push_back(thrum->userSample);
+    for (int tries = 0; tries < 60000; ++tries) {
+        bool ready = true;
+        for (const SampleHandle& sample : samples) ready = ready && sample && sample->isReady();
+        if (!ready) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        for (const SampleHandle& sample : samples)
+            if (!sample->isPlayable()) return false;
+        return true;
+    }
+    return false;
+}
+
+static const int WRITE_FRAMES = 4096;
+
+static bool renderJob(const Render& render) {
+    const Job& job = *render.job;
+    std::string path = renderPath(render);
+    rack::random::seed(job.seeded ? job.seed + render.index : hashPath(path));
+    std::unique_ptr<rack::engine::Module> m(job.type->create());
+
+    for (const Option& option : job.options) job.type->setOption(m.get(), option.name, option.value);
+    for (const Cable& cable : job.cables)
+        m->inputs[findId(job.type->inputs, cable.input)].channels = cable.channels;
+    std::vector<LanePlayer> players;
+    for (const Lane& lane : job.lanes) {
+        if (!lane.isParam) {
+            uint8_t& channels = m->inputs[lane.id].channels;
+            channels = (uint8_t)std::max<int>(channels, std::max(lane.channel + 1, 1));
+        }
+        LanePlayer player;
+        player.lane = &lane;
+        players.push_back(player);
+    }
+    int fileChannels = 0;
+    for (const Record& record : job.records) {
+        m->outputs[record.id].channels = 1;
+        fileChannels += record.channels;
+    }
+
+    rack::engine::Module::SampleRateChangeEvent e;
+    e.sampleRate = job.sampleRate;
+    e.sampleTime = 1.f / job.sampleRate;
+    m->onSampleRateChange(e);
+    Thrum* thrum = dynamic_cast<Thrum*>(m.get());
+    if (thrum && !job.samplePath.empty()) thrum->loadUserSample(job.samplePath);
+    if (thrum && !waitForSamples(thrum)) return fail(job.where, "Thrum's samples did not load for " + path);
+
+    std::string dir = rack::system::getDirectory(path);
+    if (!dir.empty()) rack::system::createDirectories(dir);
+    drwav_data_format format;
+    format.container = drwav_container_riff;
+    format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+    format.channels = fileChannels;
+    format.sampleRate = (drwav_uint32)job.sampleRate;
+    format.bitsPerSample = 32;
+    drwav wav;
+    if (!drwav_init_file_write(&wav, path.c_str(), &format, NULL)) return fail(job.where, "can't write " + path);
+
+    auto start = std::chrono::steady_clock::now();
+    rack::engine::Module::ProcessArgs args;
+    args.sampleRate = job.sampleRate;
+    args.sampleTime = 1.f / job.sampleRate;
+    int64_t frames = (int64_t)std::llround(job.seconds * job.sampleRate);
+    std::vector<float> buffer((size_t)WRITE_FRAMES * fileChannels);
+    bool written = true;
+    for (int64_t block = 0; block < frames && written; block += WRITE_FRAMES) {
+        int blockFrames = (int)std::min<int64_t>(WRITE_FRAMES, frames - block);
+        float* out = buffer.data();
+        for (int n = 0; n < blockFrames; ++n) {
+            args.frame = block + n;
+            double t = (double)args.frame / job.sampleRate;
+            for (LanePlayer& player : players) {
+                const Lane& lane = *player.lane;
+                float value = player.valueAt(t);
+                if (lane.isParam) {
+                    m->getParamQuantity(lane.id)->setValue(value);
+                }
+                else {
+                    rack::engine::Input& input = m->inputs[lane.id];
+                    if (lane.channel >= 0) input.voltages[lane.channel] = value;
+                    else for (int c = 0; c < input.channels; ++c) input.voltages[c] = value;
+                }
+            }
+            m->process(args);
+            for (const Record& record : job.records) {
+                const rack::engine::Output& output = m->outputs[record.id];
+                for (int c = 0; c < record.channels; ++c) *out++ = output.voltages[c] * job.gain;
+            }
+        }
+        written = drwav_write_pcm_frames(&wav, blockFrames, buffer.data()) == (drwav_uint64)blockFrames;
+    }
+    drwav_uninit(&wav);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!written) return fail(job.where, "ran out of room writing " + path);
+
+    // A streamed user sample can't slow the render down to wait for disk
+    uint64_t underruns = 0;
+    const ThrumSampleSet* set = thrum ? thrum->samples.getCurrent() : nullptr;
+    if (set && set->stream) underruns = set->stream->getUnderruns();
+
+    std::lock_guard<std::mutex> lock(printMutex);
+    std::printf("render file=%s module=%s rate=%.0f seconds=%g channels=%d wall_seconds=%.3f realtime=%.1f%s\n",
+        path.c_str(), job.type->name, job.sampleRate, job.seconds, fileChannels, wall, job.seconds / std::max(wall, 1e-9),
+        underruns ? (" stream_underruns=" + std::to_string(underruns)).c_str() : "");
+    std::fflush(stdout);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int threads = (int)std::thread::hardware_concurrency();
+    std::vector<Job> jobs;
+    std::vector<const char*> scripts;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-j") && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else scripts.push_back(argv[i]);
+    }
+    if (scripts.empty()) {
+        std::fprintf(stderr, "usage: %s [-j <threads>] <script>...\n", argv[0]);
+        return 2;
+    }
+    bool ok = true;
+    for (const char* script : scripts) ok = readScript(script, jobs) && ok;
+    if (!ok) return 2;
+
+    std::vector<Render> renders;
+    for (const Job& job : jobs)
+        for (int n = 0; n < job.repeat; ++n) renders.push_back(Render{&job, n});
+    DspKernels::select(nullptr);
+
+    std::atomic<size_t> nextRender{0};
+    std::atomic<int> failures{0};
+    auto work = [&]() {
+        for (size_t r; (r = nextRender.fetch_add(1)) < renders.size();)
+            if (!renderJob(renders[r])) ++failures;
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < std::min<int>(std::max(threads, 1), (int)renders.size()); ++t) workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers) worker.join();
+    return failures ? 1 : 0;
+}